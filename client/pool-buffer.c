@@ -1,3 +1,5 @@
+#undef _POSIX_C_SOURCE
+#define _GNU_SOURCE // for memfd_create and file sealing
 #include <assert.h>
 #include <cairo.h>
 #include <errno.h>
@@ -11,10 +13,22 @@
 #include <unistd.h>
 #include <wayland-client.h>
 #include "config.h"
+#include "log.h"
 #include "pool-buffer.h"
 #include "util.h"
 
+#define POOL_ALIGN 4096
+
 static int anonymous_shm_open(void) {
+#if HAVE_MEMFD_CREATE
+	int fd = memfd_create("sway-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd >= 0) {
+		// The compositor maps the file as well, so never let it shrink
+		fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL);
+		return fd;
+	}
+#endif
+
 	int retries = 100;
 
 	do {
@@ -39,6 +53,10 @@ static int anonymous_shm_open(void) {
 	return -1;
 }
 
+static size_t align_size(size_t size) {
+	return (size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+}
+
 static void buffer_release(void *data, struct wl_buffer *wl_buffer) {
 	struct pool_buffer *buffer = data;
 	buffer->busy = false;
@@ -48,68 +66,208 @@ static const struct wl_buffer_listener buffer_listener = {
 	.release = buffer_release
 };
 
-static struct pool_buffer *create_buffer(struct wl_shm *shm,
-		struct pool_buffer *buf, int32_t width, int32_t height,
-		uint32_t format) {
-	uint32_t stride = width * 4;
-	size_t size = stride * height;
+static void buffer_unmap(struct pool_buffer *buffer) {
+	if (buffer->pango) {
+		g_object_unref(buffer->pango);
+		buffer->pango = NULL;
+	}
+	if (buffer->cairo) {
+		cairo_destroy(buffer->cairo);
+		buffer->cairo = NULL;
+	}
+	if (buffer->surface) {
+		cairo_surface_destroy(buffer->surface);
+		buffer->surface = NULL;
+	}
+	buffer->data = NULL;
+}
 
-	int fd = anonymous_shm_open();
-	if (fd == -1) {
-		return NULL;
+static void buffer_map(struct buffer_pool *pool, struct pool_buffer *buffer) {
+	buffer->data = (uint8_t *)pool->data + buffer->offset;
+	buffer->surface = cairo_image_surface_create_for_data(buffer->data,
+			CAIRO_FORMAT_ARGB32, buffer->width, buffer->height,
+			buffer->width * 4);
+	buffer->cairo = cairo_create(buffer->surface);
+	buffer->pango = pango_cairo_create_context(buffer->cairo);
+}
+
+/**
+ * Destroys the wl_buffer, keeping the extent of the pool reserved for it.
+ */
+static void destroy_buffer(struct pool_buffer *buffer) {
+	if (buffer->buffer) {
+		wl_buffer_destroy(buffer->buffer);
+		buffer->buffer = NULL;
+	}
+	buffer_unmap(buffer);
+	buffer->width = buffer->height = 0;
+	buffer->size = 0;
+}
+
+static bool pool_grow(struct wl_shm *shm, struct buffer_pool *pool,
+		size_t size) {
+	if (size <= pool->size) {
+		return true;
+	}
+	// Leave room for the next few size changes
+	size = align_size(size + size / 2);
+
+	int fd = pool->data ? pool->fd : anonymous_shm_open();
+	if (fd < 0) {
+		sway_log_errno(SWAY_ERROR, "Unable to create shared memory file");
+		return false;
 	}
 	if (ftruncate(fd, size) < 0) {
+		sway_log_errno(SWAY_ERROR, "Unable to resize shared memory file");
+		goto error;
+	}
+	void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		sway_log_errno(SWAY_ERROR, "Unable to map shared memory file");
+		goto error;
+	}
+	pool->stats.maps++;
+
+	if (pool->data) {
+		munmap(pool->data, pool->size);
+		wl_shm_pool_resize(pool->shm_pool, size);
+		pool->stats.resizes++;
+	} else {
+		pool->shm_pool = wl_shm_create_pool(shm, fd, size);
+		pool->fd = fd;
+	}
+	pool->data = data;
+	pool->size = size;
+
+	// The file keeps the contents, so the buffers only need to be pointed at
+	// the new mapping
+	for (size_t i = 0; i < pool->len; ++i) {
+		struct pool_buffer *buffer = &pool->buffers[i];
+		if (buffer->buffer) {
+			buffer_unmap(buffer);
+			buffer_map(pool, buffer);
+		}
+	}
+	return true;
+
+error:
+	if (!pool->data) {
 		close(fd);
+	}
+	return false;
+}
+
+static bool extent_overlaps(struct buffer_pool *pool,
+		struct pool_buffer *buffer, size_t offset, size_t capacity) {
+	for (size_t i = 0; i < pool->len; ++i) {
+		struct pool_buffer *other = &pool->buffers[i];
+		if (other != buffer && other->capacity > 0 &&
+				offset < other->offset + other->capacity &&
+				other->offset < offset + capacity) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Reserves an extent of the pool for the buffer, preferring the lowest free
+ * offset so the pool stays compact.
+ */
+static bool pool_alloc(struct wl_shm *shm, struct buffer_pool *pool,
+		struct pool_buffer *buffer, size_t size) {
+	// Idle buffers of another size would be recreated before their next use
+	// anyway, so give their memory back first
+	for (size_t i = 0; i < pool->len; ++i) {
+		struct pool_buffer *other = &pool->buffers[i];
+		if (other != buffer && !other->busy && other->size != size) {
+			destroy_buffer(other);
+			other->capacity = 0;
+		}
+	}
+
+	// Small growth, such as a slightly taller bar, fits into the headroom
+	size_t capacity = align_size(size + size / 4);
+	size_t offset = 0;
+	bool found = !extent_overlaps(pool, buffer, 0, capacity);
+	for (size_t i = 0; i < pool->len; ++i) {
+		struct pool_buffer *other = &pool->buffers[i];
+		if (other == buffer || other->capacity == 0) {
+			continue;
+		}
+		size_t end = other->offset + other->capacity;
+		if ((!found || end < offset) &&
+				!extent_overlaps(pool, buffer, end, capacity)) {
+			offset = end;
+			found = true;
+		}
+	}
+	assert(found);
+
+	if (!pool_grow(shm, pool, offset + capacity)) {
+		return false;
+	}
+	buffer->offset = offset;
+	buffer->capacity = capacity;
+	return true;
+}
+
+static struct pool_buffer *create_buffer(struct wl_shm *shm,
+		struct buffer_pool *pool, struct pool_buffer *buf,
+		int32_t width, int32_t height, uint32_t format) {
+	uint32_t stride = width * 4;
+	size_t size = stride * height;
+
+	if (size > buf->capacity && !pool_alloc(shm, pool, buf, size)) {
 		return NULL;
 	}
-	void *data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-	struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, size);
-	buf->buffer = wl_shm_pool_create_buffer(pool, 0,
-			width, height, stride, format);
-	wl_shm_pool_destroy(pool);
-	close(fd);
 
+	buf->buffer = wl_shm_pool_create_buffer(pool->shm_pool, buf->offset,
+			width, height, stride, format);
+	pool->stats.buffers++;
 	buf->size = size;
 	buf->width = width;
 	buf->height = height;
-	buf->data = data;
-	buf->surface = cairo_image_surface_create_for_data(data,
-			CAIRO_FORMAT_ARGB32, width, height, stride);
-	buf->cairo = cairo_create(buf->surface);
-	buf->pango = pango_cairo_create_context(buf->cairo);
+	buffer_map(pool, buf);
 
 	wl_buffer_add_listener(buf->buffer, &buffer_listener, buf);
 	return buf;
 }
 
-void destroy_buffer(struct pool_buffer *buffer) {
-	if (buffer->buffer) {
-		wl_buffer_destroy(buffer->buffer);
-	}
-	if (buffer->cairo) {
-		cairo_destroy(buffer->cairo);
-	}
-	if (buffer->surface) {
-		cairo_surface_destroy(buffer->surface);
-	}
-	if (buffer->pango) {
-		g_object_unref(buffer->pango);
+void buffer_pool_init(struct buffer_pool *pool, size_t len) {
+	assert(len > 0 && len <= POOL_BUFFERS_MAX);
+	memset(pool, 0, sizeof(*pool));
+	pool->fd = -1;
+	pool->len = len;
+}
+
+void buffer_pool_finish(struct buffer_pool *pool) {
+	for (size_t i = 0; i < pool->len; ++i) {
+		destroy_buffer(&pool->buffers[i]);
 	}
-	if (buffer->data) {
-		munmap(buffer->data, buffer->size);
+	if (pool->data) {
+		sway_log(SWAY_DEBUG, "Destroying buffer pool of %zu bytes: "
+				"%zu buffers, %zu mappings, %zu resizes", pool->size,
+				pool->stats.buffers, pool->stats.maps, pool->stats.resizes);
+		wl_shm_pool_destroy(pool->shm_pool);
+		munmap(pool->data, pool->size);
+		close(pool->fd);
 	}
-	memset(buffer, 0, sizeof(struct pool_buffer));
+	size_t len = pool->len;
+	memset(pool, 0, sizeof(*pool));
+	pool->fd = -1;
+	pool->len = len;
 }
 
 struct pool_buffer *get_next_buffer(struct wl_shm *shm,
-		struct pool_buffer pool[static 2], uint32_t width, uint32_t height) {
+		struct buffer_pool *pool, uint32_t width, uint32_t height) {
 	struct pool_buffer *buffer = NULL;
 
-	for (size_t i = 0; i < 2; ++i) {
-		if (pool[i].busy) {
+	for (size_t i = 0; i < pool->len; ++i) {
+		if (pool->buffers[i].busy) {
 			continue;
 		}
-		buffer = &pool[i];
+		buffer = &pool->buffers[i];
 	}
 
 	if (!buffer) {
@@ -121,7 +279,7 @@ struct pool_buffer *get_next_buffer(struct wl_shm *shm,
 	}
 
 	if (!buffer->buffer) {
-		if (!create_buffer(shm, buffer, width, height,
+		if (!create_buffer(shm, pool, buffer, width, height,
 					WL_SHM_FORMAT_ARGB8888)) {
 			return NULL;
 		}
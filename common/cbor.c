@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cbor.h"
+#include "log.h"
+
+enum cbor_major_type {
+	CBOR_UINT = 0,
+	CBOR_NEGINT = 1,
+	CBOR_BYTES = 2,
+	CBOR_TEXT = 3,
+	CBOR_ARRAY = 4,
+	CBOR_MAP = 5,
+	CBOR_TAG = 6,
+	CBOR_SIMPLE = 7,
+};
+
+#define CBOR_FALSE 0xf4
+#define CBOR_TRUE 0xf5
+#define CBOR_NULL 0xf6
+#define CBOR_FLOAT32 0xfa
+#define CBOR_FLOAT64 0xfb
+
+static bool cbor_reserve(struct cbor_writer *writer, size_t length) {
+	if (writer->failed) {
+		return false;
+	}
+	if (writer->len + length <= writer->size) {
+		return true;
+	}
+	size_t size = writer->size ? writer->size : 256;
+	while (size < writer->len + length) {
+		size *= 2;
+	}
+	uint8_t *data = realloc(writer->data, size);
+	if (!data) {
+		sway_log(SWAY_ERROR, "Unable to allocate CBOR buffer");
+		writer->failed = true;
+		return false;
+	}
+	writer->data = data;
+	writer->size = size;
+	return true;
+}
+
+static void cbor_write_be(struct cbor_writer *writer, uint64_t value,
+		size_t bytes) {
+	for (size_t i = 0; i < bytes; ++i) {
+		writer->data[writer->len++] = value >> (8 * (bytes - i - 1));
+	}
+}
+
+static void cbor_write_head(struct cbor_writer *writer,
+		enum cbor_major_type type, uint64_t value) {
+	if (!cbor_reserve(writer, 9)) {
+		return;
+	}
+	uint8_t major = type << 5;
+	if (value < 24) {
+		writer->data[writer->len++] = major | value;
+	} else if (value <= UINT8_MAX) {
+		writer->data[writer->len++] = major | 24;
+		cbor_write_be(writer, value, 1);
+	} else if (value <= UINT16_MAX) {
+		writer->data[writer->len++] = major | 25;
+		cbor_write_be(writer, value, 2);
+	} else if (value <= UINT32_MAX) {
+		writer->data[writer->len++] = major | 26;
+		cbor_write_be(writer, value, 4);
+	} else {
+		writer->data[writer->len++] = major | 27;
+		cbor_write_be(writer, value, 8);
+	}
+}
+
+void cbor_write_array(struct cbor_writer *writer, size_t length) {
+	cbor_write_head(writer, CBOR_ARRAY, length);
+}
+
+void cbor_write_map(struct cbor_writer *writer, size_t length) {
+	cbor_write_head(writer, CBOR_MAP, length);
+}
+
+void cbor_write_string(struct cbor_writer *writer, const char *str,
+		size_t length) {
+	cbor_write_head(writer, CBOR_TEXT, length);
+	if (!cbor_reserve(writer, length)) {
+		return;
+	}
+	memcpy(writer->data + writer->len, str, length);
+	writer->len += length;
+}
+
+void cbor_write_int(struct cbor_writer *writer, int64_t value) {
+	if (value >= 0) {
+		cbor_write_head(writer, CBOR_UINT, value);
+	} else {
+		// -1 - value without overflowing on INT64_MIN
+		cbor_write_head(writer, CBOR_NEGINT, ~(uint64_t)value);
+	}
+}
+
+void cbor_write_double(struct cbor_writer *writer, double value) {
+	if (!cbor_reserve(writer, 9)) {
+		return;
+	}
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	writer->data[writer->len++] = CBOR_FLOAT64;
+	cbor_write_be(writer, bits, 8);
+}
+
+void cbor_write_bool(struct cbor_writer *writer, bool value) {
+	if (cbor_reserve(writer, 1)) {
+		writer->data[writer->len++] = value ? CBOR_TRUE : CBOR_FALSE;
+	}
+}
+
+void cbor_write_null(struct cbor_writer *writer) {
+	if (cbor_reserve(writer, 1)) {
+		writer->data[writer->len++] = CBOR_NULL;
+	}
+}
+
+void cbor_write_raw(struct cbor_writer *writer, const uint8_t *data,
+		size_t length) {
+	if (!cbor_reserve(writer, length)) {
+		return;
+	}
+	memcpy(writer->data + writer->len, data, length);
+	writer->len += length;
+}
+
+void cbor_write_json(struct cbor_writer *writer, json_object *json) {
+	switch (json_object_get_type(json)) {
+	case json_type_null:
+		cbor_write_null(writer);
+		break;
+	case json_type_boolean:
+		cbor_write_bool(writer, json_object_get_boolean(json));
+		break;
+	case json_type_double:
+		cbor_write_double(writer, json_object_get_double(json));
+		break;
+	case json_type_int:
+		cbor_write_int(writer, json_object_get_int64(json));
+		break;
+	case json_type_string:
+		cbor_write_string(writer, json_object_get_string(json),
+				json_object_get_string_len(json));
+		break;
+	case json_type_array:
+	{
+		size_t length = json_object_array_length(json);
+		cbor_write_array(writer, length);
+		for (size_t i = 0; i < length; ++i) {
+			cbor_write_json(writer, json_object_array_get_idx(json, i));
+		}
+		break;
+	}
+	case json_type_object:
+	{
+		cbor_write_map(writer, json_object_object_length(json));
+		json_object_object_foreach(json, key, value) {
+			cbor_write_string(writer, key, strlen(key));
+			cbor_write_json(writer, value);
+		}
+		break;
+	}
+	}
+}
+
+struct cbor_reader {
+	const uint8_t *data;
+	size_t len, pos;
+	bool failed;
+};
+
+static bool cbor_read_be(struct cbor_reader *reader, size_t bytes,
+		uint64_t *value) {
+	if (reader->len - reader->pos < bytes) {
+		reader->failed = true;
+		return false;
+	}
+	*value = 0;
+	for (size_t i = 0; i < bytes; ++i) {
+		*value = (*value << 8) | reader->data[reader->pos++];
+	}
+	return true;
+}
+
+static json_object *cbor_read_simple(struct cbor_reader *reader,
+		uint8_t initial) {
+	uint64_t bits;
+	switch (initial) {
+	case CBOR_FALSE:
+		return json_object_new_boolean(false);
+	case CBOR_TRUE:
+		return json_object_new_boolean(true);
+	case CBOR_NULL:
+		return NULL;
+	case CBOR_FLOAT32:
+		if (cbor_read_be(reader, 4, &bits)) {
+			uint32_t bits32 = bits;
+			float value;
+			memcpy(&value, &bits32, sizeof(value));
+			return json_object_new_double(value);
+		}
+		return NULL;
+	case CBOR_FLOAT64:
+		if (cbor_read_be(reader, 8, &bits)) {
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return json_object_new_double(value);
+		}
+		return NULL;
+	}
+	// Half precision floats and other simple values are never written by sway
+	reader->failed = true;
+	return NULL;
+}
+
+static json_object *cbor_read_item(struct cbor_reader *reader, int depth) {
+	if (depth < 0 || reader->pos >= reader->len) {
+		reader->failed = true;
+		return NULL;
+	}
+	uint8_t initial = reader->data[reader->pos++];
+	enum cbor_major_type type = initial >> 5;
+	uint8_t info = initial & 0x1f;
+
+	if (type == CBOR_SIMPLE) {
+		return cbor_read_simple(reader, initial);
+	}
+
+	uint64_t value = info;
+	if (info >= 24 && info <= 27) {
+		if (!cbor_read_be(reader, 1 << (info - 24), &value)) {
+			return NULL;
+		}
+	} else if (info > 27) {
+		// Indefinite lengths are never written by sway
+		reader->failed = true;
+		return NULL;
+	}
+
+	switch (type) {
+	case CBOR_UINT:
+		if (value > INT64_MAX) {
+			return json_object_new_double(value);
+		}
+		return json_object_new_int64(value);
+	case CBOR_NEGINT:
+		if (value > INT64_MAX) {
+			return json_object_new_double(-1.0 - value);
+		}
+		return json_object_new_int64(-1 - (int64_t)value);
+	case CBOR_TEXT:
+	{
+		if (reader->len - reader->pos < value) {
+			reader->failed = true;
+			return NULL;
+		}
+		json_object *string = json_object_new_string_len(
+				(const char *)reader->data + reader->pos, value);
+		reader->pos += value;
+		return string;
+	}
+	case CBOR_ARRAY:
+	{
+		json_object *array = json_object_new_array();
+		for (uint64_t i = 0; i < value && !reader->failed; ++i) {
+			json_object_array_add(array, cbor_read_item(reader, depth - 1));
+		}
+		return array;
+	}
+	case CBOR_MAP:
+	{
+		json_object *object = json_object_new_object();
+		for (uint64_t i = 0; i < value && !reader->failed; ++i) {
+			json_object *key = cbor_read_item(reader, depth - 1);
+			if (!json_object_is_type(key, json_type_string)) {
+				json_object_put(key);
+				reader->failed = true;
+				break;
+			}
+			json_object_object_add(object, json_object_get_string(key),
+					cbor_read_item(reader, depth - 1));
+			json_object_put(key);
+		}
+		return object;
+	}
+	case CBOR_BYTES:
+	case CBOR_TAG:
+	case CBOR_SIMPLE:
+		break;
+	}
+	reader->failed = true;
+	return NULL;
+}
+
+json_object *cbor_parse(const uint8_t *data, size_t length, int max_depth) {
+	struct cbor_reader reader = { .data = data, .len = length };
+	json_object *json = cbor_read_item(&reader, max_depth);
+	if (reader.failed || reader.pos != reader.len) {
+		json_object_put(json);
+		return NULL;
+	}
+	return json;
+}
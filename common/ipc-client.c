@@ -1,3 +1,4 @@
+#include <json.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -146,3 +147,48 @@ char *ipc_single_command(int socketfd, uint32_t type, const char *payload, uint3
 
 	return response;
 }
+
+static bool ipc_supports_encoding(int socketfd, const char *encoding) {
+	uint32_t len = 0;
+	char *res = ipc_single_command(socketfd, IPC_GET_VERSION, "", &len);
+	json_object *version = json_tokener_parse(res);
+	free(res);
+	if (!version) {
+		return false;
+	}
+	bool supported = false;
+	json_object *encodings;
+	if (json_object_object_get_ex(version, "encodings", &encodings) &&
+			json_object_is_type(encodings, json_type_array)) {
+		for (size_t i = 0; i < json_object_array_length(encodings); ++i) {
+			const char *name = json_object_get_string(
+				json_object_array_get_idx(encodings, i));
+			if (name && strcmp(name, encoding) == 0) {
+				supported = true;
+				break;
+			}
+		}
+	}
+	json_object_put(version);
+	return supported;
+}
+
+bool ipc_set_encoding(int socketfd, const char *encoding) {
+	// Versions of sway without SET_ENCODING never reply to it, so only send it
+	// if GET_VERSION lists the encoding
+	if (!ipc_supports_encoding(socketfd, encoding)) {
+		return false;
+	}
+	uint32_t len = strlen(encoding);
+	char *res = ipc_single_command(socketfd, IPC_SET_ENCODING, encoding, &len);
+	json_object *reply = json_tokener_parse(res);
+	free(res);
+	if (!reply) {
+		return false;
+	}
+	json_object *success;
+	bool result = json_object_object_get_ex(reply, "success", &success) &&
+		json_object_get_boolean(success);
+	json_object_put(reply);
+	return result;
+}
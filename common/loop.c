@@ -19,6 +19,7 @@ struct loop_timer {
 	void (*callback)(void *data);
 	void *data;
 	struct timespec expiry;
+	int index; // in loop::timers, -1 once removed
 };
 
 struct loop {
@@ -27,9 +28,72 @@ struct loop {
 	int fd_capacity;
 
 	list_t *fd_events; // struct loop_fd_event
-	list_t *timers; // struct loop_timer
+	list_t *timers; // struct loop_timer, a binary min-heap by expiry
 };
 
+static bool timer_before(const struct timespec *a, const struct timespec *b) {
+	return a->tv_sec < b->tv_sec ||
+		(a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static void timer_heap_set(struct loop *loop, int index,
+		struct loop_timer *timer) {
+	loop->timers->items[index] = timer;
+	timer->index = index;
+}
+
+static void timer_heap_sift_up(struct loop *loop, int index) {
+	struct loop_timer *timer = loop->timers->items[index];
+	while (index > 0) {
+		int parent_index = (index - 1) / 2;
+		struct loop_timer *parent = loop->timers->items[parent_index];
+		if (!timer_before(&timer->expiry, &parent->expiry)) {
+			break;
+		}
+		timer_heap_set(loop, index, parent);
+		index = parent_index;
+	}
+	timer_heap_set(loop, index, timer);
+}
+
+static void timer_heap_sift_down(struct loop *loop, int index) {
+	int length = loop->timers->length;
+	struct loop_timer *timer = loop->timers->items[index];
+	while (true) {
+		int child_index = 2 * index + 1;
+		if (child_index >= length) {
+			break;
+		}
+		struct loop_timer *child = loop->timers->items[child_index];
+		if (child_index + 1 < length) {
+			struct loop_timer *right = loop->timers->items[child_index + 1];
+			if (timer_before(&right->expiry, &child->expiry)) {
+				child = right;
+				++child_index;
+			}
+		}
+		if (!timer_before(&child->expiry, &timer->expiry)) {
+			break;
+		}
+		timer_heap_set(loop, index, child);
+		index = child_index;
+	}
+	timer_heap_set(loop, index, timer);
+}
+
+static void timer_heap_remove(struct loop *loop, struct loop_timer *timer) {
+	int index = timer->index;
+	int last_index = loop->timers->length - 1;
+	struct loop_timer *last = loop->timers->items[last_index];
+	list_del(loop->timers, last_index);
+	timer->index = -1;
+	if (last != timer) {
+		timer_heap_set(loop, index, last);
+		timer_heap_sift_up(loop, index);
+		timer_heap_sift_down(loop, last->index);
+	}
+}
+
 struct loop *loop_create(void) {
 	struct loop *loop = calloc(1, sizeof(struct loop));
 	if (!loop) {
@@ -51,19 +115,14 @@ void loop_destroy(struct loop *loop) {
 }
 
 void loop_poll(struct loop *loop) {
-	// Calculate next timer in ms
+	// Calculate next timer in ms, which is at the top of the heap
 	int ms = INT_MAX;
 	if (loop->timers->length) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
-		for (int i = 0; i < loop->timers->length; ++i) {
-			struct loop_timer *timer = loop->timers->items[i];
-			int timer_ms = (timer->expiry.tv_sec - now.tv_sec) * 1000;
-			timer_ms += (timer->expiry.tv_nsec - now.tv_nsec) / 1000000;
-			if (timer_ms < ms) {
-				ms = timer_ms;
-			}
-		}
+		struct loop_timer *timer = loop->timers->items[0];
+		ms = (timer->expiry.tv_sec - now.tv_sec) * 1000;
+		ms += (timer->expiry.tv_nsec - now.tv_nsec) / 1000000;
 	}
 	if (ms < 0) {
 		ms = 0;
@@ -84,20 +143,20 @@ void loop_poll(struct loop *loop) {
 		}
 	}
 
-	// Dispatch timers
+	// Dispatch timers, stopping at the first one which hasn't expired
 	if (loop->timers->length) {
 		struct timespec now;
 		clock_gettime(CLOCK_MONOTONIC, &now);
-		for (int i = 0; i < loop->timers->length; ++i) {
-			struct loop_timer *timer = loop->timers->items[i];
-			bool expired = timer->expiry.tv_sec < now.tv_sec ||
-				(timer->expiry.tv_sec == now.tv_sec &&
-				 timer->expiry.tv_nsec < now.tv_nsec);
-			if (expired) {
-				timer->callback(timer->data);
-				loop_remove_timer(loop, timer);
-				--i;
+		while (loop->timers->length) {
+			struct loop_timer *timer = loop->timers->items[0];
+			if (!timer_before(&timer->expiry, &now)) {
+				break;
 			}
+			// Removed first, so the callback may add timers or try to
+			// remove this one
+			timer_heap_remove(loop, timer);
+			timer->callback(timer->data);
+			free(timer);
 		}
 	}
 }
@@ -151,6 +210,7 @@ struct loop_timer *loop_add_timer(struct loop *loop, int ms,
 	timer->expiry.tv_nsec += nsec;
 
 	list_add(loop->timers, timer);
+	timer_heap_sift_up(loop, loop->timers->length - 1);
 
 	return timer;
 }
@@ -172,12 +232,11 @@ bool loop_remove_fd(struct loop *loop, int fd) {
 }
 
 bool loop_remove_timer(struct loop *loop, struct loop_timer *timer) {
-	for (int i = 0; i < loop->timers->length; ++i) {
-		if (loop->timers->items[i] == timer) {
-			list_del(loop->timers, i);
-			free(timer);
-			return true;
-		}
+	if (timer->index < 0) {
+		// Being dispatched, and freed afterwards
+		return false;
 	}
-	return false;
+	timer_heap_remove(loop, timer);
+	free(timer);
+	return true;
 }
@@ -8,6 +8,7 @@
 #include <string.h>
 #include "cairo_util.h"
 #include "log.h"
+#include "pango.h"
 #include "stringop.h"
 
 size_t escape_markup_text(const char *src, char *dest) {
@@ -50,11 +51,79 @@ size_t escape_markup_text(const char *src, char *dest) {
 	return length;
 }
 
-PangoLayout *get_pango_layout(cairo_t *cairo, const PangoFontDescription *desc,
-		const char *text, double scale, bool markup) {
-	PangoLayout *layout = pango_cairo_create_layout(cairo);
-	pango_context_set_round_glyph_positions(pango_layout_get_context(layout), false);
+/**
+ * Layouts used to measure and render text are kept around for the lifetime
+ * of the process rather than being created for every call, since creating a
+ * PangoContext is comparatively expensive.
+ *
+ * Measurements are additionally memoized: the same labels (workspace names,
+ * status blocks, titles) are measured over and over again.
+ */
+#define TEXT_SIZE_CACHE_MAX 1024
+
+struct text_size_key {
+	PangoFontDescription *desc;
+	char *text;
+	double scale;
+	bool markup;
+	cairo_matrix_t matrix;
+	unsigned long font_options_hash;
+};
+
+struct text_size_entry {
+	struct text_size_key key;
+	int width, height, baseline;
+};
 
+static struct {
+	PangoContext *measure_context;
+	PangoLayout *measure_layout;
+	PangoContext *render_context;
+	PangoLayout *render_layout;
+	GHashTable *sizes;
+	struct text_stats stats;
+} text_pool;
+
+static void create_pooled_layout(PangoContext **context, PangoLayout **layout) {
+	if (*layout) {
+		return;
+	}
+	*context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+	pango_context_set_round_glyph_positions(*context, false);
+	*layout = pango_layout_new(*context);
+	text_pool.stats.contexts_created++;
+}
+
+static guint text_size_key_hash(gconstpointer data) {
+	const struct text_size_key *key = data;
+	guint hash = g_str_hash(key->text);
+	hash = hash * 31 + pango_font_description_hash(key->desc);
+	hash = hash * 31 + g_double_hash(&key->scale);
+	hash = hash * 31 + g_double_hash(&key->matrix.xx);
+	hash = hash * 31 + g_double_hash(&key->matrix.yy);
+	hash = hash * 31 + key->font_options_hash;
+	return hash * 31 + key->markup;
+}
+
+static gboolean text_size_key_equal(gconstpointer a_data, gconstpointer b_data) {
+	const struct text_size_key *a = a_data, *b = b_data;
+	return a->markup == b->markup &&
+		a->scale == b->scale &&
+		a->font_options_hash == b->font_options_hash &&
+		memcmp(&a->matrix, &b->matrix, sizeof(a->matrix)) == 0 &&
+		strcmp(a->text, b->text) == 0 &&
+		pango_font_description_equal(a->desc, b->desc);
+}
+
+static void text_size_entry_destroy(gpointer data) {
+	struct text_size_entry *entry = data;
+	pango_font_description_free(entry->key.desc);
+	free(entry->key.text);
+	free(entry);
+}
+
+static void set_layout_text(PangoLayout *layout, const PangoFontDescription *desc,
+		const char *text, double scale, bool markup) {
 	PangoAttrList *attrs;
 	if (markup) {
 		char *buf;
@@ -79,9 +148,28 @@ PangoLayout *get_pango_layout(cairo_t *cairo, const PangoFontDescription *desc,
 	pango_layout_set_single_paragraph_mode(layout, 1);
 	pango_layout_set_attributes(layout, attrs);
 	pango_attr_list_unref(attrs);
+}
+
+PangoLayout *get_pango_layout(cairo_t *cairo, const PangoFontDescription *desc,
+		const char *text, double scale, bool markup) {
+	PangoLayout *layout = pango_cairo_create_layout(cairo);
+	pango_context_set_round_glyph_positions(pango_layout_get_context(layout), false);
+	set_layout_text(layout, desc, text, scale, markup);
 	return layout;
 }
 
+static void measure_text(cairo_t *cairo, const PangoFontDescription *desc,
+		const char *text, double scale, bool markup, struct text_size_entry *size) {
+	create_pooled_layout(&text_pool.measure_context, &text_pool.measure_layout);
+	PangoLayout *layout = text_pool.measure_layout;
+
+	pango_cairo_update_context(cairo, text_pool.measure_context);
+	pango_layout_context_changed(layout);
+	set_layout_text(layout, desc, text, scale, markup);
+	pango_layout_get_pixel_size(layout, &size->width, &size->height);
+	size->baseline = pango_layout_get_baseline(layout) / PANGO_SCALE;
+}
+
 void get_text_size(cairo_t *cairo, const PangoFontDescription *desc, int *width, int *height,
 		int *baseline, double scale, bool markup, const char *fmt, ...) {
 	va_list args;
@@ -92,21 +180,65 @@ void get_text_size(cairo_t *cairo, const PangoFontDescription *desc, int *width,
 		return;
 	}
 
-	PangoLayout *layout = get_pango_layout(cairo, desc, buf, scale, markup);
-	pango_cairo_update_layout(cairo, layout);
-	pango_layout_get_pixel_size(layout, width, height);
-	if (baseline) {
-		*baseline = pango_layout_get_baseline(layout) / PANGO_SCALE;
+	if (!text_pool.sizes) {
+		text_pool.sizes = g_hash_table_new_full(text_size_key_hash,
+			text_size_key_equal, text_size_entry_destroy, NULL);
 	}
-	g_object_unref(layout);
 
-	free(buf);
+	// Hinting depends on the transformation and the font options of the
+	// target, so those are part of the key
+	struct text_size_key key = {
+		.desc = (PangoFontDescription *)desc,
+		.text = buf,
+		.scale = scale,
+		.markup = markup,
+	};
+	cairo_get_matrix(cairo, &key.matrix);
+	cairo_font_options_t *fo = cairo_font_options_create();
+	cairo_surface_get_font_options(cairo_get_target(cairo), fo);
+	key.font_options_hash = cairo_font_options_hash(fo);
+	cairo_font_options_destroy(fo);
+
+	struct text_size_entry *entry = g_hash_table_lookup(text_pool.sizes, &key);
+	if (entry) {
+		text_pool.stats.measure_hits++;
+		free(buf);
+	} else {
+		text_pool.stats.measure_misses++;
+		entry = calloc(1, sizeof(*entry));
+		if (!entry) {
+			sway_log(SWAY_ERROR, "Unable to allocate text size cache entry");
+			free(buf);
+			return;
+		}
+		measure_text(cairo, desc, buf, scale, markup, entry);
+
+		if (g_hash_table_size(text_pool.sizes) >= TEXT_SIZE_CACHE_MAX) {
+			g_hash_table_remove_all(text_pool.sizes);
+		}
+		entry->key = key;
+		entry->key.desc = pango_font_description_copy(desc);
+		g_hash_table_add(text_pool.sizes, entry);
+	}
+
+	if (width) {
+		*width = entry->width;
+	}
+	if (height) {
+		*height = entry->height;
+	}
+	if (baseline) {
+		*baseline = entry->baseline;
+	}
 }
 
 void get_text_metrics(const PangoFontDescription *description, int *height, int *baseline) {
-	cairo_t *cairo = cairo_create(NULL);
-	PangoContext *pango = pango_cairo_create_context(cairo);
-	pango_context_set_round_glyph_positions(pango, false);
+	create_pooled_layout(&text_pool.measure_context, &text_pool.measure_layout);
+	PangoContext *pango = text_pool.measure_context;
+	// Measure like a fresh context would, not with the transformation and
+	// hinting of whichever surface get_text_size last measured for
+	pango_context_set_matrix(pango, NULL);
+	pango_cairo_context_set_font_options(pango, NULL);
 	// When passing NULL as a language, pango uses the current locale.
 	PangoFontMetrics *metrics = pango_context_get_metrics(pango, description, NULL);
 
@@ -114,8 +246,6 @@ void get_text_metrics(const PangoFontDescription *description, int *height, int
 	*height = *baseline + pango_font_metrics_get_descent(metrics) / PANGO_SCALE;
 
 	pango_font_metrics_unref(metrics);
-	g_object_unref(pango);
-	cairo_destroy(cairo);
 }
 
 void render_text(cairo_t *cairo, const PangoFontDescription *desc,
@@ -128,14 +258,24 @@ void render_text(cairo_t *cairo, const PangoFontDescription *desc,
 		return;
 	}
 
-	PangoLayout *layout = get_pango_layout(cairo, desc, buf, scale, markup);
+	create_pooled_layout(&text_pool.render_context, &text_pool.render_layout);
+	PangoLayout *layout = text_pool.render_layout;
+
 	cairo_font_options_t *fo = cairo_font_options_create();
 	cairo_get_font_options(cairo, fo);
-	pango_cairo_context_set_font_options(pango_layout_get_context(layout), fo);
+	pango_cairo_context_set_font_options(text_pool.render_context, fo);
 	cairo_font_options_destroy(fo);
-	pango_cairo_update_layout(cairo, layout);
+	pango_cairo_update_context(cairo, text_pool.render_context);
+	pango_layout_context_changed(layout);
+	set_layout_text(layout, desc, buf, scale, markup);
 	pango_cairo_show_layout(cairo, layout);
-	g_object_unref(layout);
+	text_pool.stats.renders++;
 
 	free(buf);
 }
+
+void get_text_stats(struct text_stats *stats) {
+	*stats = text_pool.stats;
+	stats->measure_entries =
+		text_pool.sizes ? g_hash_table_size(text_pool.sizes) : 0;
+}
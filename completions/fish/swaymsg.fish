@@ -21,5 +21,9 @@ complete -c swaymsg -s t -l type -fra 'get_binding_modes' --description "Gets a
 complete -c swaymsg -s t -l type -fra 'get_binding_state' --description "Get JSON-encoded info about the current binding state."
 complete -c swaymsg -s t -l type -fra 'get_config' --description "Gets a JSON-encoded copy of the current configuration."
 complete -c swaymsg -s t -l type -fra 'get_seats' --description "Gets a JSON-encoded list of all seats, its properties and all assigned devices."
+complete -c swaymsg -s t -l type -fra 'get_stats' --description "Gets JSON-encoded internal statistics of the running instance of sway."
+complete -c swaymsg -s t -l type -fra 'get_output_stats' --description "Gets JSON-encoded frame timing statistics of each output."
+complete -c swaymsg -s t -l type -fra 'get_transaction_stats' --description "Gets JSON-encoded configure latency statistics of each client."
+complete -c swaymsg -s t -l type -fra 'get_tree_snapshot' --description "Gets a JSON-encoded layout tree with the serial of the last tree_patch event."
 complete -c swaymsg -s t -l type -fra 'send_tick' --description "Sends a tick event to all subscribed clients."
 complete -c swaymsg -s t -l type -fra 'subscribe' --description "Subscribe to a list of event types."
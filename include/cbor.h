@@ -0,0 +1,47 @@
+#ifndef _SWAY_CBOR_H
+#define _SWAY_CBOR_H
+#include <json.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Appends CBOR (RFC 8949) data items to a growing buffer. Allocation failures
+ * are remembered in failed, so a sequence of writes only needs to be checked
+ * once at the end.
+ */
+struct cbor_writer {
+	uint8_t *data;
+	size_t len, size;
+	bool failed;
+};
+
+void cbor_write_array(struct cbor_writer *writer, size_t length);
+void cbor_write_map(struct cbor_writer *writer, size_t length);
+void cbor_write_string(struct cbor_writer *writer, const char *str,
+		size_t length);
+void cbor_write_int(struct cbor_writer *writer, int64_t value);
+void cbor_write_double(struct cbor_writer *writer, double value);
+void cbor_write_bool(struct cbor_writer *writer, bool value);
+void cbor_write_null(struct cbor_writer *writer);
+
+/**
+ * Appends data which is already encoded as complete CBOR data items.
+ */
+void cbor_write_raw(struct cbor_writer *writer, const uint8_t *data,
+		size_t length);
+
+/**
+ * Writes the json-c value as the equivalent CBOR data item, walking the
+ * objects directly rather than going through their JSON serialization.
+ */
+void cbor_write_json(struct cbor_writer *writer, json_object *json);
+
+/**
+ * Decodes a single CBOR data item into json-c objects. Only the subset of
+ * CBOR which has a JSON equivalent is accepted. Returns NULL if the data is
+ * invalid or nested deeper than max_depth.
+ */
+json_object *cbor_parse(const uint8_t *data, size_t length, int max_depth);
+
+#endif
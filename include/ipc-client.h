@@ -41,6 +41,13 @@ struct ipc_response *ipc_recv_response(int socketfd);
  * Free ipc_response struct
  */
 void free_ipc_response(struct ipc_response *response);
+/**
+ * Asks sway to use the given encoding ("json" or "cbor") for replies and
+ * events on the socket. Must be called while the socket still uses JSON.
+ * Returns false, leaving the socket on JSON, if the encoding isn't supported
+ * by the running sway.
+ */
+bool ipc_set_encoding(int socketfd, const char *encoding);
 /**
  * Sets the receive timeout for the IPC socket
  */
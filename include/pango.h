@@ -14,12 +14,26 @@
  * escaped string to dest if provided.
  */
 size_t escape_markup_text(const char *src, char *dest);
+
+struct text_stats {
+	uint64_t measure_hits;
+	uint64_t measure_misses;
+	uint64_t renders;
+	uint64_t contexts_created;
+	size_t measure_entries;
+};
+
 PangoLayout *get_pango_layout(cairo_t *cairo, const PangoFontDescription *desc,
 		const char *text, double scale, bool markup);
 void get_text_size(cairo_t *cairo, const PangoFontDescription *desc, int *width, int *height,
 		int *baseline, double scale, bool markup, const char *fmt, ...) _SWAY_ATTRIB_PRINTF(8, 9);
 void get_text_metrics(const PangoFontDescription *desc, int *height, int *baseline);
-void render_text(cairo_t *cairo, PangoFontDescription *desc,
+void render_text(cairo_t *cairo, const PangoFontDescription *desc,
 		double scale, bool markup, const char *fmt, ...) _SWAY_ATTRIB_PRINTF(5, 6);
+/**
+ * Reports how often text had to be shaped by pango in this process. Results of
+ * get_text_size are memoized by font, markup flag, scale and text.
+ */
+void get_text_stats(struct text_stats *stats);
 
 #endif
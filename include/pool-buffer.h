@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <wayland-client.h>
 
+#define POOL_BUFFERS_MAX 4
+
 struct pool_buffer {
 	struct wl_buffer *buffer;
 	cairo_surface_t *surface;
@@ -14,11 +16,35 @@ struct pool_buffer {
 	uint32_t width, height;
 	void *data;
 	size_t size;
+	size_t offset, capacity; // extent reserved in the pool, kept across sizes
 	bool busy;
 };
 
+struct buffer_pool_stats {
+	size_t maps; // mmap calls, one per pool resize
+	size_t resizes; // wl_shm_pool_resize requests
+	size_t buffers; // wl_buffers created
+};
+
+/**
+ * A set of buffers sub-allocated from a single shared memory file and
+ * wl_shm_pool. The pool only ever grows, with some headroom, so buffers can
+ * change size without remapping memory each time.
+ */
+struct buffer_pool {
+	struct wl_shm_pool *shm_pool;
+	int fd; // only valid while data is mapped
+	void *data;
+	size_t size;
+	size_t len; // number of buffers in use, up to POOL_BUFFERS_MAX
+	struct pool_buffer buffers[POOL_BUFFERS_MAX];
+	struct buffer_pool_stats stats;
+};
+
+void buffer_pool_init(struct buffer_pool *pool, size_t len);
+void buffer_pool_finish(struct buffer_pool *pool);
+
 struct pool_buffer *get_next_buffer(struct wl_shm *shm,
-		struct pool_buffer pool[static 2], uint32_t width, uint32_t height);
-void destroy_buffer(struct pool_buffer *buffer);
+		struct buffer_pool *pool, uint32_t width, uint32_t height);
 
 #endif
@@ -191,6 +191,7 @@ sway_cmd cmd_title_align;
 sway_cmd cmd_title_format;
 sway_cmd cmd_titlebar_border_thickness;
 sway_cmd cmd_titlebar_padding;
+sway_cmd cmd_transaction_coalesce;
 sway_cmd cmd_unbindcode;
 sway_cmd cmd_unbindswitch;
 sway_cmd cmd_unbindgesture;
@@ -219,6 +220,7 @@ sway_cmd bar_cmd_position;
 sway_cmd bar_cmd_separator_symbol;
 sway_cmd bar_cmd_status_command;
 sway_cmd bar_cmd_status_edge_padding;
+sway_cmd bar_cmd_status_max_fps;
 sway_cmd bar_cmd_status_padding;
 sway_cmd bar_cmd_pango_markup;
 sway_cmd bar_cmd_strip_workspace_numbers;
@@ -107,10 +107,15 @@ enum sway_fowa {
 /**
  * A "mode" of keybindings created via the `mode` command.
  */
+struct sway_binding_index;
+
 struct sway_mode {
 	char *name;
 	list_t *keysym_bindings;
 	list_t *keycode_bindings;
+	// Lookup indexes for the two lists above, built on demand
+	struct sway_binding_index *keysym_index;
+	struct sway_binding_index *keycode_index;
 	list_t *mouse_bindings;
 	list_t *switch_bindings;
 	list_t *gesture_bindings;
@@ -273,6 +278,10 @@ enum color_profile {
 	COLOR_PROFILE_TRANSFORM_WITH_DEVICE_PRIMARIES, // create transform from wlr_output
 };
 
+// Value of output_config.max_render_time which estimates the render time from
+// the timings of previous frames
+#define MAX_RENDER_TIME_AUTO -2
+
 /**
  * Size and position configuration for a particular output.
  *
@@ -291,7 +300,7 @@ struct output_config {
 	enum scale_filter_mode scale_filter;
 	int32_t transform;
 	enum wl_output_subpixel subpixel;
-	int max_render_time; // In milliseconds
+	int max_render_time; // In milliseconds, or MAX_RENDER_TIME_AUTO
 	int adaptive_sync;
 	enum render_bit_depth render_bit_depth;
 	enum color_profile color_profile;
@@ -381,6 +390,7 @@ struct bar_config {
 	struct side_gaps gaps;
 	int status_padding;
 	int status_edge_padding;
+	int status_max_fps; // 0 for no limit
 	uint32_t workspace_min_width;
 	struct {
 		char *background;
@@ -486,6 +496,8 @@ enum xwayland_mode {
 	XWAYLAND_MODE_IMMEDIATE,
 };
 
+struct criteria_index;
+
 /**
  * The configuration struct. The result of loading a config file.
  */
@@ -502,6 +514,7 @@ struct sway_config {
 	list_t *input_type_configs;
 	list_t *seat_configs;
 	list_t *criteria;
+	struct criteria_index *criteria_index; // built on demand
 	list_t *no_focus;
 	list_t *active_bar_modifiers;
 	struct sway_mode *current_mode;
@@ -551,6 +564,8 @@ struct sway_config {
 	bool tiling_drag;
 	int tiling_drag_threshold;
 
+	bool transaction_coalesce;
+
 	enum smart_gaps_mode smart_gaps;
 	int gaps_inner;
 	struct side_gaps gaps_outer;
@@ -758,6 +773,28 @@ void translate_keysyms(struct input_config *input_config);
 
 void binding_add_translated(struct sway_binding *binding, list_t *bindings);
 
+/**
+ * Returns the lookup index for a list of key bindings of a mode, building it
+ * if necessary. See binding_index_get_candidates.
+ */
+struct sway_binding_index *binding_index_get(
+		struct sway_binding_index **index, list_t *bindings);
+
+/**
+ * Drops the lookup indexes of the mode. Must be called whenever its keysym or
+ * keycode bindings are changed.
+ */
+void mode_invalidate_binding_index(struct sway_mode *mode);
+
+/**
+ * Appends to candidates all bindings with the given modifiers and release
+ * flag whose keys are either exactly the pressed keys, or only the current
+ * key. The candidates are in the order of the bindings list of the index.
+ */
+void binding_index_get_candidates(struct sway_binding_index *index,
+		uint32_t modifiers, bool release, const uint32_t *pressed_keys,
+		size_t npressed, uint32_t current_key, list_t *candidates);
+
 /* Global config singleton. */
 extern struct sway_config *config;
 
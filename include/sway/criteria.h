@@ -19,14 +19,44 @@ enum criteria_type {
 	CT_NO_FOCUS                = 1 << 4,
 };
 
+/**
+ * The view properties a criteria can depend on. A criteria only needs to be
+ * checked again when one of its fields has changed.
+ */
+enum criteria_field {
+	CF_TITLE       = 1 << 0,
+	CF_APP_ID      = 1 << 1,
+	CF_CLASS       = 1 << 2,
+	CF_INSTANCE    = 1 << 3,
+	CF_WINDOW_ROLE = 1 << 4,
+	CF_WINDOW_TYPE = 1 << 5,
+	CF_TAG         = 1 << 6,
+	CF_MARK        = 1 << 7,
+	// State which changes without notifying criteria, such as floating or
+	// urgency, and comparisons against the focused view
+	CF_STATE       = 1 << 8,
+	CF_ALL         = (1 << 9) - 1,
+};
+
 enum pattern_type {
 	PATTERN_PCRE2,
 	PATTERN_FOCUSED,
 };
 
+enum pattern_literal {
+	LITERAL_NONE,
+	LITERAL_SUBSTRING, // foo
+	LITERAL_PREFIX, // ^foo
+	LITERAL_EXACT, // ^foo$
+};
+
 struct pattern {
 	enum pattern_type match_type;
 	pcre2_code *regex;
+	// Set if the regex is a plain string, which is then matched without pcre2
+	enum pattern_literal literal_type;
+	char *literal;
+	size_t literal_len;
 };
 
 struct criteria {
@@ -57,6 +87,16 @@ struct criteria {
 	struct pattern *sandbox_app_id;
 	struct pattern *sandbox_instance_id;
 	struct pattern *tag;
+
+	uint32_t fields; // enum criteria_field
+	uint64_t matches; // number of times the criteria matched a view
+};
+
+struct criteria_stats {
+	uint64_t lookups;
+	uint64_t evaluations;
+	size_t indexed;
+	size_t unindexed;
 };
 
 bool criteria_is_empty(struct criteria *criteria);
@@ -83,6 +123,23 @@ struct criteria *criteria_parse(char *raw, char **error);
  */
 list_t *criteria_for_view(struct sway_view *view, enum criteria_type types);
 
+/**
+ * Like criteria_for_view, but only checks criteria depending on the changed
+ * fields, which are a bitwise OR of enum criteria_field.
+ */
+list_t *criteria_for_view_changed(struct sway_view *view,
+		enum criteria_type types, uint32_t changed);
+
+/**
+ * Drops the lookup index of config->criteria. Must be called whenever a
+ * criteria is added to the list.
+ */
+void criteria_invalidate_index(void);
+
+void criteria_index_destroy(struct criteria_index *index);
+
+void criteria_get_stats(struct criteria_stats *stats);
+
 /**
  * Compile a list of containers matching the given criteria.
  */
@@ -2,6 +2,8 @@
 #define _SWAY_TRANSACTION_H
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/types.h>
+#include <wayland-server-core.h>
 #include <wlr/types/wlr_scene.h>
 
 /**
@@ -24,6 +26,41 @@
 struct sway_transaction_instruction;
 struct sway_view;
 
+/**
+ * How quickly a client acks the configures sent by transactions. This decides
+ * how long a transaction waits for the client. A client which keeps timing out
+ * is considered slow, and transactions stop waiting for it apart from an
+ * occasional probe, so that it cannot hold back the rest of the layout.
+ *
+ * Xwayland clients share a wl_client and are told apart by their pid.
+ */
+struct sway_transaction_client {
+	struct wl_client *client;
+	pid_t pid;
+	char *name; // app_id or class of the last configured view
+
+	uint64_t configures; // configures waited for
+	uint64_t acks; // configures acked before the transaction timed out
+	uint64_t timeouts;
+	uint64_t skipped; // configures not waited for while the client was slow
+	int64_t latency_usec; // smoothed configure to ack latency
+	int64_t latency_var_usec; // smoothed mean deviation of the latency
+	int64_t latency_max_usec;
+	int consecutive_timeouts;
+	int skipped_since_probe;
+
+	struct wl_list link; // sway_server::transaction_clients
+	struct wl_listener client_destroy;
+};
+
+bool transaction_client_is_slow(struct sway_transaction_client *client);
+
+/**
+ * Returns how long a transaction waits for the client, at most the global
+ * transaction timeout.
+ */
+size_t transaction_client_get_timeout(struct sway_transaction_client *client);
+
 /**
  * Find all dirty containers, create and commit a transaction containing them,
  * and unmark them as dirty.
@@ -70,6 +70,9 @@ struct sway_seat_node {
 	struct sway_node *node;
 
 	struct wl_list link; // sway_seat::focus_stack
+	struct wl_list node_link; // sway_node::seat_nodes
+	// Position in the focus stack, higher values were focused more recently
+	int64_t stamp;
 
 	struct wl_listener destroy;
 };
@@ -95,6 +98,7 @@ struct sway_seat {
 
 	bool has_focus;
 	struct wl_list focus_stack; // list of containers in focus order
+	int64_t focus_stamp_top, focus_stamp_bottom;
 	struct sway_workspace *workspace;
 	char *prev_workspace_name; // for workspace back_and_forth
 
@@ -241,6 +245,15 @@ struct sway_node *seat_get_active_tiling_child(struct sway_seat *seat,
 void seat_for_each_node(struct sway_seat *seat,
 		void (*f)(struct sway_node *node, void *data), void *data);
 
+/**
+ * Iterate over the immediate children of the node in focus order, most
+ * recently focused first. Children which were never seen by the seat are
+ * skipped.
+ */
+void seat_for_each_child_in_focus_order(struct sway_seat *seat,
+		struct sway_node *parent,
+		void (*f)(struct sway_node *node, void *data), void *data);
+
 void seat_apply_config(struct sway_seat *seat, struct seat_config *seat_config);
 
 struct seat_config *seat_get_config(struct sway_seat *seat);
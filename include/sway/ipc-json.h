@@ -9,10 +9,73 @@ json_object *ipc_json_get_version(void);
 
 json_object *ipc_json_get_binding_mode(void);
 
+json_object *ipc_json_get_stats(void);
+
+/**
+ * Describe the frame timings of the output, in microseconds, over the last
+ * OUTPUT_STATS_FRAMES presented frames.
+ */
+json_object *ipc_json_describe_output_stats(struct sway_output *output);
+
+json_object *ipc_json_get_transaction_stats(void);
+
 json_object *ipc_json_describe_disabled_output(struct sway_output *o);
 json_object *ipc_json_describe_non_desktop_output(struct sway_output_non_desktop *o);
 json_object *ipc_json_describe_node(struct sway_node *node);
 json_object *ipc_json_describe_node_recursive(struct sway_node *node);
+
+/**
+ * Returns the serialized get_tree reply, reusing the cached fragments of
+ * unchanged nodes. The string is owned by the root node and is only valid
+ * until the tree is next invalidated. Returns NULL on allocation failure.
+ */
+const char *ipc_json_get_tree(size_t *len);
+
+/**
+ * Like ipc_json_get_tree, but returns the reply encoded as CBOR.
+ */
+const uint8_t *ipc_json_get_tree_cbor(size_t *len);
+
+/**
+ * Drops the cached get_tree JSON of the node and its ancestors.
+ */
+void ipc_json_invalidate_node(struct sway_node *node);
+
+/**
+ * Drops the cached get_tree JSON of the node, its descendants and its
+ * ancestors, for changes which also show in the descendants (visibility).
+ */
+void ipc_json_invalidate_subtree(struct sway_node *node);
+
+/**
+ * Describe the properties of a node for tree_patch changes. This reads the
+ * pending state, so for a transaction it has to be called when the
+ * transaction is committed, while the pending state is what it applies.
+ */
+json_object *ipc_json_describe_patch_node(struct sway_node *node);
+
+/**
+ * Append the tree_patch changes made by applying a transaction's state to a
+ * node. Must be called before the state is applied. described is the node
+ * as described when the transaction was committed, or NULL to describe it
+ * now.
+ */
+void ipc_json_describe_output_patch(json_object *changes,
+		struct sway_output *output, struct sway_output_state *state,
+		json_object *described);
+void ipc_json_describe_workspace_patch(json_object *changes,
+		struct sway_workspace *ws, struct sway_workspace_state *state,
+		json_object *described);
+void ipc_json_describe_container_patch(json_object *changes,
+		struct sway_container *con, struct sway_container_state *state,
+		json_object *described);
+
+/**
+ * Append a tree_patch change with all properties of the node, for changes
+ * which don't go through a transaction (title, marks, urgency).
+ */
+void ipc_json_describe_property_patch(json_object *changes,
+		struct sway_node *node);
 json_object *ipc_json_describe_input(struct sway_input_device *device);
 json_object *ipc_json_describe_seat(struct sway_seat *seat);
 json_object *ipc_json_describe_bar_config(struct bar_config *bar);
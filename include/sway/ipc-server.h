@@ -1,5 +1,6 @@
 #ifndef _SWAY_IPC_SERVER_H
 #define _SWAY_IPC_SERVER_H
+#include <json.h>
 #include <sys/socket.h>
 #include "sway/config.h"
 #include "sway/input/input-manager.h"
@@ -22,5 +23,21 @@ void ipc_event_shutdown(const char *reason);
 void ipc_event_binding(struct sway_binding *binding);
 void ipc_event_input(const char *change, struct sway_input_device *device);
 void ipc_event_output(void);
+void ipc_event_output_stats(struct sway_output *output);
+
+/**
+ * Whether any client is subscribed to tree_patch events.
+ */
+bool ipc_event_tree_patch_wanted(void);
+/**
+ * Returns a new array to collect tree_patch changes in, or NULL if no client
+ * is subscribed to tree_patch events.
+ */
+json_object *ipc_event_tree_patch_begin(void);
+/**
+ * Sends the collected changes as a tree_patch event, if there are any. Takes
+ * ownership of the array.
+ */
+void ipc_event_tree_patch(json_object *changes);
 
 #endif
@@ -18,6 +18,42 @@ struct sway_output_state {
 	struct sway_workspace *active_workspace;
 };
 
+// Number of frames kept for the timing statistics of each output
+#define OUTPUT_STATS_FRAMES 128
+
+struct sway_output_frame_timing {
+	uint32_t build_usec; // wlr_scene_output_build_state
+	uint32_t commit_usec; // wlr_output_commit_state
+	uint32_t present_usec; // from the start of the repaint to presentation
+	// Presentation time minus the predicted refresh, 0 without a prediction
+	int32_t prediction_error_usec;
+};
+
+struct sway_output_stats {
+	// Ring buffer of the last presented frames
+	struct sway_output_frame_timing frames[OUTPUT_STATS_FRAMES];
+	size_t frames_len, frames_pos;
+
+	uint64_t presented;
+	uint64_t missed; // presented at least half a refresh after the prediction
+	uint64_t discarded; // committed but never presented
+	uint64_t failed; // commits which failed
+	uint64_t tearing_requested;
+	uint64_t tearing_fallbacks; // tearing page-flips rejected by the test
+	uint64_t tearing_flips;
+
+	// State of the frame being rendered or waiting for presentation
+	bool predicted;
+	struct timespec predicted_refresh;
+	bool in_flight;
+	struct timespec repaint_start;
+	struct sway_output_frame_timing pending;
+
+	// Added to the estimated render time with max_render_time auto. Grows
+	// when a frame is missed and shrinks with each frame on time.
+	int64_t render_margin_usec;
+};
+
 struct sway_output {
 	struct sway_node node;
 
@@ -67,10 +103,13 @@ struct sway_output {
 	struct timespec last_presentation;
 	uint32_t refresh_nsec;
 	int max_render_time; // In milliseconds
+	bool max_render_time_auto; // max_render_time is updated with each frame
 	struct wl_event_source *repaint_timer;
 
 	bool allow_tearing;
 	bool hdr;
+
+	struct sway_output_stats stats;
 };
 
 struct sway_output_non_desktop {
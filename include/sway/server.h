@@ -132,6 +132,7 @@ struct sway_server {
 	// The timeout for transactions, after which a transaction is applied
 	// regardless of readiness.
 	size_t txn_timeout_ms;
+	struct wl_list transaction_clients; // sway_transaction_client::link
 
 	// Stores a transaction after it has been committed, but is waiting for
 	// views to ack the new dimensions before being applied. A queued
@@ -143,6 +144,13 @@ struct sway_server {
 	// updated with new instructions as needed.
 	struct sway_transaction *pending_transaction;
 
+	// With transaction_coalesce, delays committing the pending transaction so
+	// that updates arriving within the refresh interval of the fastest output
+	// share a transaction.
+	struct wl_event_source *txn_commit_timer;
+	bool txn_commit_scheduled; // txn_commit_timer is armed
+	struct timespec txn_last_commit;
+
 	// Stores the nodes that have been marked as "dirty" and will be put into
 	// the pending transaction.
 	list_t *dirty_nodes;
@@ -156,6 +164,9 @@ struct sway_debug {
 	bool noatomic;         // Ignore atomic layout updates
 	bool txn_timings;      // Log verbose messages about transactions
 	bool txn_wait;         // Always wait for the timeout before applying
+	bool scene_check;      // Compare incremental scene updates to a full one
+	bool txn_coalesce;     // Force transaction_coalesce on
+	bool focus_check;      // Compare focus queries to a focus stack walk
 };
 
 extern struct sway_debug debug;
@@ -1,5 +1,6 @@
 #ifndef _SWAY_BUFFER_H
 #define _SWAY_BUFFER_H
+#include <stdint.h>
 #include <wlr/types/wlr_scene.h>
 
 struct sway_text_node {
@@ -14,6 +15,14 @@ struct sway_text_node {
 	struct wlr_scene_node *node;
 };
 
+struct sway_text_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes;
+};
+
 struct sway_text_node *sway_text_node_create(struct wlr_scene_tree *parent,
 		char *text, float color[4], bool pango_markup);
 
@@ -25,4 +34,10 @@ void sway_text_node_set_max_width(struct sway_text_node *node, int max_width);
 
 void sway_text_node_set_background(struct sway_text_node *node, float background[4]);
 
+/**
+ * Rendered text buffers are shared between all text nodes that would produce
+ * identical pixels. This reports the state of that shared cache.
+ */
+void sway_text_node_get_cache_stats(struct sway_text_cache_stats *stats);
+
 #endif
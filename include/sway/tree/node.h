@@ -2,6 +2,7 @@
 #define _SWAY_NODE_H
 #include <wayland-server-core.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <wlr/types/wlr_scene.h>
 #include "list.h"
 
@@ -38,13 +39,29 @@ struct sway_node {
 	size_t id;
 
 	struct sway_transaction_instruction *instruction;
+	// The node's instruction in the transaction which has not been committed
+	// yet, if any
+	struct sway_transaction_instruction *pending_instruction;
 	size_t ntxnrefs;
 	bool destroying;
 
+	struct wl_list seat_nodes; // sway_seat_node::node_link
+
 	// If true, indicates that the container has pending state that differs from
 	// the current.
 	bool dirty;
 
+	// If true, the scene graph of this node has to be arranged again once the
+	// transaction it is part of has been applied. Only used for workspaces.
+	bool scene_stale;
+
+	// Serialized get_tree JSON and CBOR for this node's subtree, or NULL if
+	// they have been invalidated or not requested yet (see ipc-json.c).
+	char *ipc_json;
+	size_t ipc_json_len;
+	uint8_t *ipc_cbor;
+	size_t ipc_cbor_len;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
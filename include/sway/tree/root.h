@@ -69,6 +69,11 @@ struct sway_root {
 
 	struct sway_container *fullscreen_global;
 
+	// Whether the scene was last arranged with a global fullscreen container.
+	// Toggling global fullscreen changes every output, so transactions keep
+	// arranging the whole tree until it is back in its regular layout.
+	bool arranged_fullscreen_global;
+
 	struct {
 		struct wl_signal new_node;
 	} events;
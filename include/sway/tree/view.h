@@ -338,9 +338,10 @@ void view_update_title(struct sway_view *view, bool force);
 
 /**
  * Run any criteria that match the view and haven't been run on this view
- * before.
+ * before. Only criteria depending on the changed properties, a bitwise OR of
+ * enum criteria_field, are checked.
  */
-void view_execute_criteria(struct sway_view *view);
+void view_execute_criteria(struct sway_view *view, uint32_t changed);
 
 /**
  * Returns true if there's a possibility the view may be rendered on screen.
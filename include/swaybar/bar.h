@@ -8,6 +8,9 @@
 #include "wlr-layer-shell-unstable-v1-client-protocol.h"
 #include "xdg-output-unstable-v1-client-protocol.h"
 
+// A third buffer keeps drawing when the compositor holds on to two of them
+#define SWAYBAR_BUFFERS 3
+
 struct swaybar_config;
 struct swaybar_output;
 #if HAVE_TRAY
@@ -15,6 +18,7 @@ struct swaybar_tray;
 #endif
 struct swaybar_workspace;
 struct loop;
+struct loop_timer;
 
 struct swaybar {
 	char *id;
@@ -41,6 +45,8 @@ struct swaybar {
 
 	int ipc_event_socketfd;
 	int ipc_socketfd;
+	// Whether the messages on each socket are encoded as CBOR
+	bool ipc_cbor, ipc_event_cbor;
 
 	struct wl_list outputs; // swaybar_output::link
 	struct wl_list unused_outputs; // swaybar_output::link
@@ -50,9 +56,25 @@ struct swaybar {
 	struct swaybar_tray *tray;
 #endif
 
+	// Incremented whenever state shared by all outputs changes
+	uint64_t content_serial;
+
+	// Status updates are rate limited to status_max_fps, see status_in
+	struct loop_timer *status_timer;
+	uint32_t status_update_time; // in msec, of the last one shown
+
 	bool running;
 };
 
+/**
+ * A horizontal span of the bar, covering its full height. Used to track which
+ * parts of the bar changed between frames.
+ */
+struct swaybar_render_region {
+	int x, width; // in surface coordinates
+	uint64_t hash; // of everything which determines the pixels of the region
+};
+
 struct swaybar_output {
 	struct wl_list link; // swaybar::outputs
 	struct swaybar *bar;
@@ -72,11 +94,27 @@ struct swaybar_output {
 	uint32_t width, height;
 	int32_t scale;
 	enum wl_output_subpixel subpixel;
-	struct pool_buffer buffers[2];
+	struct buffer_pool pool;
 	struct pool_buffer *current_buffer;
 	bool dirty;
 	bool frame_scheduled;
 
+	// Damage tracking, see render_frame
+	struct swaybar_render_region *regions; // drawn in the last frame
+	size_t regions_len;
+	uint64_t frame_key; // hash of the state which affects the whole bar
+	bool damage_all; // the next frame must be drawn and damaged entirely
+	struct swaybar_render_region *last_damage; // changed by the last frame
+	size_t last_damage_len;
+	bool last_damage_all;
+	uint64_t frames;
+	uint64_t buffer_frames[POOL_BUFFERS_MAX]; // frame last drawn into each buffer
+
+	// Identical outputs share their frames, see render_frame
+	uint64_t render_key; // of the contents of current_buffer
+	bool render_key_valid;
+	bool opaque;
+
 	uint32_t output_height, output_width, output_x, output_y;
 };
 
@@ -50,6 +50,7 @@ struct swaybar_config {
 	int height;
 	int status_padding;
 	int status_edge_padding;
+	int status_max_fps; // 0 for no limit
 	struct {
 		int top;
 		int right;
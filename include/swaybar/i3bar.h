@@ -1,9 +1,40 @@
 #ifndef _SWAYBAR_I3BAR_H
 #define _SWAYBAR_I3BAR_H
 
+#include <cairo.h>
+#include <pango/pango.h>
 #include "input.h"
 #include "status_line.h"
 
+/**
+ * Text sizes of a block, see render_status_block. Only valid for the font and
+ * output scale they were measured with.
+ */
+struct i3bar_block_size {
+	int full_width, full_height;
+	int short_width, short_height;
+	int min_width;
+};
+
+/**
+ * The text of a block rasterized for one output, kept so that unchanged blocks
+ * don't have to be shaped and rasterized again on every frame.
+ */
+struct i3bar_block_surface {
+	struct wl_list link; // i3bar_block::surfaces
+	cairo_surface_t *surface;
+	int x, y; // relative to the text origin, in buffer pixels
+
+	int scale;
+	bool short_text;
+	uint32_t color;
+	double phase; // subpixel position of the text origin
+	// Only set if the text was drawn on an opaque background
+	bool subpixel_aa;
+	uint32_t background;
+	cairo_subpixel_order_t subpixel_order;
+};
+
 struct i3bar_block {
 	struct wl_list link; // status_link::blocks
 	int ref_count;
@@ -24,10 +55,23 @@ struct i3bar_block {
 	int border_bottom;
 	int border_left;
 	int border_right;
+
+	// Render cache, carried over to the matching block of the next update
+	uint64_t hash; // of all of the above which affects rendering
+	PangoFontDescription *measured_font;
+	int measured_scale;
+	struct i3bar_block_size size;
+	struct wl_list surfaces; // i3bar_block_surface::link, most recent first
 };
 
 void i3bar_block_unref(struct i3bar_block *block);
+void i3bar_block_surfaces_clear(struct i3bar_block *block);
 bool i3bar_handle_readable(struct status_line *status);
+/**
+ * Parses the newest status update received by i3bar_handle_readable, if it
+ * hasn't been parsed yet.
+ */
+void i3bar_parse_pending(struct status_line *status);
 enum hotspot_event_handling i3bar_block_send_click(struct status_line *status,
 		struct i3bar_block *block, double x, double y, double rx, double ry,
 		double w, double h, int scale, uint32_t button, bool released);
@@ -51,6 +51,8 @@ struct swaybar_hotspot {
 		struct swaybar_hotspot *hotspot, double x, double y, uint32_t button,
 		bool released, void *data);
 	void (*destroy)(void *data);
+	// Duplicates data for the hotspots of another output showing the same bar
+	void *(*copy)(void *data);
 	void *data;
 };
 
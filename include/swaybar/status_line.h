@@ -36,6 +36,17 @@ struct status_line {
 	bool started;
 	bool expecting_comma;
 	json_tokener *tokener;
+
+	// Element boundaries of the i3bar stream, see i3bar_handle_readable
+	size_t scan_pos;
+	int scan_depth;
+	bool scan_in_string, scan_escaped;
+	char *frame; // newest complete element, not parsed yet if frame_pending
+	size_t frame_len, frame_size;
+	bool frame_pending;
+
+	uint64_t updates_dropped; // replaced by a newer one before being shown
+	uint64_t updates_coalesced; // arrived while a redraw was already pending
 };
 
 struct status_line *status_line_init(char *cmd);
@@ -1,6 +1,8 @@
 #ifndef _SWAYBAR_TRAY_ICON_H
 #define _SWAYBAR_TRAY_ICON_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "list.h"
 
 struct icon_theme_subdir {
@@ -28,16 +30,37 @@ struct icon_theme {
 	list_t *subdirs; // struct icon_theme_subdir *
 };
 
+struct icon_index_entry;
+
+/*
+ * Contents of the icon directories which have been searched so far. The fd is
+ * an inotify instance watching those directories, or -1.
+ */
+struct icon_index {
+	int fd;
+	struct icon_index_entry **buckets;
+	size_t nbuckets; // power of two
+	size_t len;
+};
+
 void init_themes(list_t **themes, list_t **basedirs);
 void finish_themes(list_t *themes, list_t *basedirs);
 
+struct icon_index *create_icon_index(void);
+void destroy_icon_index(struct icon_index *index);
+/*
+ * Drains the inotify events of the index and drops its contents if any of the
+ * directories changed. Returns whether anything changed.
+ */
+bool icon_index_handle_readable(struct icon_index *index);
+
 /*
  * Finds an icon of a specified size given a list of themes and base directories.
  * If the icon is found, the pointers min_size & max_size are set to minimum &
  * maximum size that the icon can be scaled to, respectively.
  * Returns: path of icon (which should be freed), or NULL if the icon is not found.
  */
-char *find_icon(list_t *themes, list_t *basedirs, char *name, int size,
-		char *theme, int *min_size, int *max_size);
+char *find_icon(struct icon_index *index, list_t *themes, list_t *basedirs,
+		char *name, int size, char *theme, int *min_size, int *max_size);
 
 #endif
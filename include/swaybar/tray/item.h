@@ -12,6 +12,7 @@ struct swaybar_output;
 
 struct swaybar_pixmap {
 	int size;
+	uint64_t hash; // of the pixels, to find them in the icon cache quickly
 	unsigned char pixels[];
 };
 
@@ -31,6 +32,7 @@ struct swaybar_sni {
 	int min_size;
 	int max_size;
 	int target_size;
+	uint32_t serial; // incremented whenever the icon has to be reloaded
 
 	// dbus properties
 	char *watcher_id;
@@ -11,11 +11,15 @@
 #endif
 #include <cairo.h>
 #include <stdint.h>
+#include <sys/stat.h>
+#include <wayland-util.h>
 #include "swaybar/tray/host.h"
 #include "list.h"
 
 struct swaybar;
+struct icon_index;
 struct swaybar_output;
+struct swaybar_pixmap;
 struct swaybar_watcher;
 
 struct swaybar_tray {
@@ -32,11 +36,51 @@ struct swaybar_tray {
 
 	list_t *basedirs; // char *
 	list_t *themes; // struct swaybar_theme *
+	struct icon_index *icons;
+
+	struct wl_list icon_cache; // swaybar_tray_icon::link
+	uint64_t icon_cache_generation; // incremented on every render_tray
+};
+
+/**
+ * A decoded icon, either loaded from a file or copied from a pixmap, or a
+ * scaled version of one. Shared between all items and outputs.
+ */
+struct swaybar_tray_icon {
+	struct wl_list link; // swaybar_tray::icon_cache
+	// Loaded from a file, which is reloaded once it has been modified
+	char *path;
+	struct timespec mtime;
+	off_t file_size;
+	// Copied from a pixmap, whose pixels are compared if the hash matches
+	uint64_t pixmap_hash;
+	// Scaled from another icon, which is referenced while this one exists
+	cairo_surface_t *source;
+	int size; // of the scaled icon
+	cairo_surface_t *surface;
+	uint64_t last_used; // swaybar_tray::icon_cache_generation
 };
 
 struct swaybar_tray *create_tray(struct swaybar *bar);
 void destroy_tray(struct swaybar_tray *tray);
 void tray_in(int fd, short mask, void *data);
+void tray_icons_in(int fd, short mask, void *data);
+
+/**
+ * Return a new reference to the icon loaded from the file, the pixmap, or
+ * the icon scaled to size, from the icon cache if possible. Return NULL if
+ * the icon can't be loaded.
+ */
+cairo_surface_t *tray_load_file_icon(struct swaybar_tray *tray,
+		const char *path);
+cairo_surface_t *tray_load_pixmap_icon(struct swaybar_tray *tray,
+		struct swaybar_pixmap *pixmap);
+cairo_surface_t *tray_scale_icon(struct swaybar_tray *tray,
+		cairo_surface_t *icon, int size);
+/**
+ * Lays out the tray items and creates their hotspots if cairo is NULL,
+ * otherwise only draws them.
+ */
 uint32_t render_tray(cairo_t *cairo, struct swaybar_output *output, double *x);
 
 #endif
@@ -9,6 +9,7 @@
 #include "swaynag/types.h"
 
 #define SWAYNAG_MAX_HEIGHT 500
+#define SWAYNAG_BUFFERS 3
 
 struct swaynag;
 
@@ -93,7 +94,7 @@ struct swaynag {
 	uint32_t width;
 	uint32_t height;
 	int32_t scale;
-	struct pool_buffer buffers[2];
+	struct buffer_pool pool;
 	struct pool_buffer *current_buffer;
 
 	struct swaynag_type *type;
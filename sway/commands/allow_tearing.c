@@ -1,5 +1,6 @@
 #include <sway/commands.h>
 #include "sway/config.h"
+#include "sway/ipc-json.h"
 #include "sway/tree/view.h"
 #include "util.h"
 
@@ -19,6 +20,7 @@ struct cmd_results *cmd_allow_tearing(int argc, char **argv) {
 	struct sway_view *view = container->view;
 	view->tearing_mode = wants_tearing ? TEARING_OVERRIDE_TRUE :
 		TEARING_OVERRIDE_FALSE;
+	ipc_json_invalidate_node(&container->node);
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
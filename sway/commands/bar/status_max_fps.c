@@ -0,0 +1,24 @@
+#include <stdlib.h>
+#include <string.h>
+#include "sway/commands.h"
+#include "log.h"
+
+struct cmd_results *bar_cmd_status_max_fps(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "status_max_fps", EXPECTED_EQUAL_TO, 1))) {
+		return error;
+	}
+	int max_fps = 0;
+	if (strcmp(argv[0], "off") != 0) {
+		char *end;
+		max_fps = strtol(argv[0], &end, 10);
+		if (strlen(end) || max_fps <= 0) {
+			return cmd_results_new(CMD_INVALID,
+					"Expected 'status_max_fps <fps>|off'");
+		}
+	}
+	config->current_bar->status_max_fps = max_fps;
+	sway_log(SWAY_DEBUG, "Status max fps on bar %s: %d",
+			config->current_bar->id, config->current_bar->status_max_fps);
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
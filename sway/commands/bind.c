@@ -481,6 +481,7 @@ static struct cmd_results *cmd_bindsym_or_bindcode(int argc, char **argv,
 		mode_bindings = config->current_mode->mouse_bindings;
 	}
 
+	mode_invalidate_binding_index(config->current_mode);
 	if (unbind) {
 		return binding_remove(binding, mode_bindings, bindtype, argv[0]);
 	}
@@ -758,3 +759,201 @@ void binding_add_translated(struct sway_binding *binding,
 		free_sway_binding(config_binding);
 	}
 }
+
+struct binding_index_item {
+	struct sway_binding *binding;
+	int position; // in the bindings list the index was built from
+};
+
+struct binding_index_entry {
+	uint32_t hash;
+	uint32_t modifiers;
+	bool release;
+	list_t *keys; // borrowed from the first binding
+	struct binding_index_item *items;
+	size_t items_len, items_cap;
+	struct binding_index_entry *next;
+};
+
+struct sway_binding_index {
+	struct binding_index_entry **buckets;
+	size_t nbuckets; // power of two
+};
+
+static uint32_t binding_index_hash(uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	// FNV-1a over the modifiers, release flag and key ids
+	uint32_t hash = 2166136261;
+	uint32_t words[] = { modifiers, release, nkeys };
+	for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+		hash = (hash ^ words[i]) * 16777619;
+	}
+	for (size_t i = 0; i < nkeys; i++) {
+		hash = (hash ^ keys[i]) * 16777619;
+	}
+	return hash;
+}
+
+static bool binding_index_entry_matches(struct binding_index_entry *entry,
+		uint32_t hash, uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	if (entry->hash != hash || entry->modifiers != modifiers ||
+			entry->release != release ||
+			(size_t)entry->keys->length != nkeys) {
+		return false;
+	}
+	for (size_t i = 0; i < nkeys; i++) {
+		if (*(uint32_t *)entry->keys->items[i] != keys[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static struct binding_index_entry *binding_index_find(
+		struct sway_binding_index *index, uint32_t modifiers, bool release,
+		const uint32_t *keys, size_t nkeys) {
+	uint32_t hash = binding_index_hash(modifiers, release, keys, nkeys);
+	struct binding_index_entry *entry =
+		index->buckets[hash & (index->nbuckets - 1)];
+	for (; entry; entry = entry->next) {
+		if (binding_index_entry_matches(entry, hash, modifiers, release,
+				keys, nkeys)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void binding_index_destroy(struct sway_binding_index *index) {
+	if (!index) {
+		return;
+	}
+	for (size_t i = 0; i < index->nbuckets; i++) {
+		struct binding_index_entry *entry = index->buckets[i];
+		while (entry) {
+			struct binding_index_entry *next = entry->next;
+			free(entry->items);
+			free(entry);
+			entry = next;
+		}
+	}
+	free(index->buckets);
+	free(index);
+}
+
+static bool binding_index_add(struct sway_binding_index *index,
+		struct sway_binding *binding, int position) {
+	size_t nkeys = binding->keys->length;
+	uint32_t *keys = calloc(nkeys > 0 ? nkeys : 1, sizeof(*keys));
+	if (!keys) {
+		return false;
+	}
+	for (size_t i = 0; i < nkeys; i++) {
+		keys[i] = *(uint32_t *)binding->keys->items[i];
+	}
+	bool release = binding->flags & BINDING_RELEASE;
+
+	struct binding_index_entry *entry = binding_index_find(index,
+		binding->modifiers, release, keys, nkeys);
+	if (!entry) {
+		entry = calloc(1, sizeof(*entry));
+		if (!entry) {
+			free(keys);
+			return false;
+		}
+		entry->hash = binding_index_hash(binding->modifiers, release,
+			keys, nkeys);
+		entry->modifiers = binding->modifiers;
+		entry->release = release;
+		entry->keys = binding->keys;
+		size_t bucket = entry->hash & (index->nbuckets - 1);
+		entry->next = index->buckets[bucket];
+		index->buckets[bucket] = entry;
+	}
+	free(keys);
+
+	if (entry->items_len == entry->items_cap) {
+		size_t cap = entry->items_cap ? entry->items_cap * 2 : 2;
+		struct binding_index_item *items =
+			realloc(entry->items, cap * sizeof(*items));
+		if (!items) {
+			return false;
+		}
+		entry->items = items;
+		entry->items_cap = cap;
+	}
+	entry->items[entry->items_len++] = (struct binding_index_item){
+		.binding = binding,
+		.position = position,
+	};
+	return true;
+}
+
+static struct sway_binding_index *binding_index_create(list_t *bindings) {
+	struct sway_binding_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		return NULL;
+	}
+	index->nbuckets = 16;
+	while (index->nbuckets < (size_t)bindings->length * 2) {
+		index->nbuckets *= 2;
+	}
+	index->buckets = calloc(index->nbuckets, sizeof(*index->buckets));
+	if (!index->buckets) {
+		free(index);
+		return NULL;
+	}
+
+	for (int i = 0; i < bindings->length; ++i) {
+		if (!binding_index_add(index, bindings->items[i], i)) {
+			binding_index_destroy(index);
+			return NULL;
+		}
+	}
+	return index;
+}
+
+struct sway_binding_index *binding_index_get(
+		struct sway_binding_index **index, list_t *bindings) {
+	if (!*index) {
+		*index = binding_index_create(bindings);
+		if (!*index) {
+			sway_log(SWAY_ERROR, "Unable to allocate binding index");
+		}
+	}
+	return *index;
+}
+
+void mode_invalidate_binding_index(struct sway_mode *mode) {
+	binding_index_destroy(mode->keysym_index);
+	binding_index_destroy(mode->keycode_index);
+	mode->keysym_index = NULL;
+	mode->keycode_index = NULL;
+}
+
+void binding_index_get_candidates(struct sway_binding_index *index,
+		uint32_t modifiers, bool release, const uint32_t *pressed_keys,
+		size_t npressed, uint32_t current_key, list_t *candidates) {
+	struct binding_index_entry *exact = binding_index_find(index,
+		modifiers, release, pressed_keys, npressed);
+	struct binding_index_entry *single = NULL;
+	if (npressed != 1) {
+		// Single-key bindings also match the newly pressed key
+		single = binding_index_find(index, modifiers, release,
+			&current_key, 1);
+	}
+
+	// Merge both by list position to keep the precedence of the list order
+	size_t i = 0, j = 0;
+	size_t exact_len = exact ? exact->items_len : 0;
+	size_t single_len = single ? single->items_len : 0;
+	while (i < exact_len || j < single_len) {
+		if (j >= single_len || (i < exact_len &&
+				exact->items[i].position < single->items[j].position)) {
+			list_add(candidates, exact->items[i++].binding);
+		} else {
+			list_add(candidates, single->items[j++].binding);
+		}
+	}
+}
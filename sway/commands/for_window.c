@@ -31,6 +31,7 @@ struct cmd_results *cmd_for_window(int argc, char **argv) {
 	}
 
 	list_add(config->criteria, criteria);
+	criteria_invalidate_index();
 	sway_log(SWAY_DEBUG, "for_window: '%s' -> '%s' added", criteria->raw, criteria->cmdlist);
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
@@ -1,6 +1,7 @@
 #include <string.h>
 #include "sway/commands.h"
 #include "sway/config.h"
+#include "sway/criteria.h"
 #include "sway/tree/view.h"
 #include "list.h"
 #include "log.h"
@@ -60,7 +61,7 @@ struct cmd_results *cmd_mark(int argc, char **argv) {
 	free(mark);
 	container_update_marks(container);
 	if (container->view) {
-		view_execute_criteria(container->view);
+		view_execute_criteria(container->view, CF_MARK);
 	}
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
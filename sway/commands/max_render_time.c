@@ -1,6 +1,7 @@
 #include <strings.h>
 #include "sway/commands.h"
 #include "sway/config.h"
+#include "sway/ipc-json.h"
 #include "sway/tree/view.h"
 
 struct cmd_results *cmd_max_render_time(int argc, char **argv) {
@@ -27,6 +28,7 @@ struct cmd_results *cmd_max_render_time(int argc, char **argv) {
 
 	struct sway_view *view = container->view;
 	view->max_render_time = max_render_time;
+	ipc_json_invalidate_node(&container->node);
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
@@ -29,6 +29,7 @@ struct cmd_results *cmd_no_focus(int argc, char **argv) {
 	}
 
 	list_add(config->criteria, criteria);
+	criteria_invalidate_index();
 
 	return cmd_results_new(CMD_SUCCESS, NULL);
 }
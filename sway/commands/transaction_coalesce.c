@@ -0,0 +1,13 @@
+#include "sway/commands.h"
+#include "sway/config.h"
+#include "util.h"
+
+struct cmd_results *cmd_transaction_coalesce(int argc, char **argv) {
+	struct cmd_results *error = NULL;
+	if ((error = checkarg(argc, "transaction_coalesce", EXPECTED_EQUAL_TO, 1))) {
+		return error;
+	}
+	config->transaction_coalesce =
+		parse_boolean(argv[0], config->transaction_coalesce);
+	return cmd_results_new(CMD_SUCCESS, NULL);
+}
@@ -67,6 +67,7 @@ static void free_mode(struct sway_mode *mode) {
 		return;
 	}
 	free(mode->name);
+	mode_invalidate_binding_index(mode);
 	if (mode->keysym_bindings) {
 		for (int i = 0; i < mode->keysym_bindings->length; i++) {
 			free_sway_binding(mode->keysym_bindings->items[i]);
@@ -166,6 +167,7 @@ void free_config(struct sway_config *config) {
 		}
 		list_free(config->criteria);
 	}
+	criteria_index_destroy(config->criteria_index);
 	list_free(config->no_focus);
 	list_free(config->active_bar_modifiers);
 	list_free_items_and_destroy(config->config_chain);
@@ -229,7 +231,7 @@ static void config_defaults(struct sway_config *config) {
 
 	if (!(config->cmd_queue = create_list())) goto cleanup;
 
-	if (!(config->current_mode = malloc(sizeof(struct sway_mode))))
+	if (!(config->current_mode = calloc(1, sizeof(struct sway_mode))))
 		goto cleanup;
 	if (!(config->current_mode->name = malloc(sizeof("default")))) goto cleanup;
 	strcpy(config->current_mode->name, "default");
@@ -282,6 +284,7 @@ static void config_defaults(struct sway_config *config) {
 	config->title_align = ALIGN_LEFT;
 	config->tiling_drag = true;
 	config->tiling_drag_threshold = 9;
+	config->transaction_coalesce = false;
 	config->primary_selection = true;
 
 	config->smart_gaps = SMART_GAPS_OFF;
@@ -1006,6 +1009,7 @@ void translate_keysyms(struct input_config *input_config) {
 
 		mode->keysym_bindings = bindsyms;
 		mode->keycode_bindings = bindcodes;
+		mode_invalidate_binding_index(mode);
 	}
 
 	sway_log(SWAY_DEBUG, "Translated keysyms using config for device '%s'",
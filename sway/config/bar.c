@@ -105,6 +105,7 @@ struct bar_config *default_bar_config(void) {
 	bar->modifier = get_modifier_mask_by_name("Mod4");
 	bar->status_padding = 1;
 	bar->status_edge_padding = 3;
+	bar->status_max_fps = 0;
 	bar->workspace_min_width = 0;
 	if (!(bar->mode = strdup("dock"))) {
 	       goto cleanup;
@@ -682,6 +682,12 @@ static bool finalize_output_config(struct output_config *oc, struct sway_output
 	}
 	output->color_transform = config_applied->color_transform;
 
+	bool max_render_time_auto =
+		oc && oc->max_render_time == MAX_RENDER_TIME_AUTO;
+	if (max_render_time_auto && !output->max_render_time_auto) {
+		output->stats.render_margin_usec = 0;
+	}
+	output->max_render_time_auto = max_render_time_auto;
 	output->max_render_time = oc && oc->max_render_time > 0 ? oc->max_render_time : 0;
 	output->allow_tearing = oc && oc->allow_tearing > 0;
 	output->hdr = applied->image_description != NULL;
@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <strings.h>
 #define PCRE2_CODE_UNIT_WIDTH 8
 #include <pcre2.h>
@@ -65,6 +67,34 @@ static bool generate_regex(pcre2_code **regex, char *value) {
 	return true;
 }
 
+// Most criteria values are plain strings, optionally anchored at the start
+// or at both ends. Those are matched with string functions instead of pcre2.
+static void pattern_detect_literal(struct pattern *pattern, const char *value) {
+	size_t len = strlen(value);
+	bool prefix = len > 0 && value[0] == '^';
+	bool exact = prefix && len > 1 && value[len - 1] == '$';
+	const char *start = value + prefix;
+	size_t literal_len = len - prefix - exact;
+	for (size_t i = 0; i < literal_len; ++i) {
+		if (strchr("\\^$.|?*+()[]{}", start[i])) {
+			return;
+		}
+	}
+
+	pattern->literal = strndup(start, literal_len);
+	if (!pattern->literal) {
+		return;
+	}
+	pattern->literal_len = literal_len;
+	if (exact) {
+		pattern->literal_type = LITERAL_EXACT;
+	} else if (prefix) {
+		pattern->literal_type = LITERAL_PREFIX;
+	} else {
+		pattern->literal_type = LITERAL_SUBSTRING;
+	}
+}
+
 static bool pattern_create(struct pattern **pattern, char *value) {
 	*pattern = calloc(1, sizeof(struct pattern));
 	if (!*pattern) {
@@ -78,6 +108,7 @@ static bool pattern_create(struct pattern **pattern, char *value) {
 		if (!generate_regex(&(*pattern)->regex, value)) {
 			return false;
 		};
+		pattern_detect_literal(*pattern, value);
 	}
 	return true;
 }
@@ -87,6 +118,7 @@ static void pattern_destroy(struct pattern *pattern) {
 		if (pattern->regex) {
 			pcre2_code_free(pattern->regex);
 		}
+		free(pattern->literal);
 		free(pattern);
 	}
 }
@@ -113,10 +145,38 @@ void criteria_destroy(struct criteria *criteria) {
 }
 
 static int regex_cmp(const char *item, const pcre2_code *regex) {
-	pcre2_match_data *match_data = pcre2_match_data_create_from_pattern(regex, NULL);
-	int result = pcre2_match(regex, (PCRE2_SPTR)item, strlen(item), 0, 0, match_data, NULL);
-	pcre2_match_data_free(match_data);
-	return result;
+	// Only whether there is a match is needed, so a single pair of offsets is
+	// enough for every pattern and the match data can be reused
+	static pcre2_match_data *match_data = NULL;
+	if (!match_data) {
+		match_data = pcre2_match_data_create(1, NULL);
+		if (!match_data) {
+			return PCRE2_ERROR_NOMEMORY;
+		}
+	}
+	return pcre2_match(regex, (PCRE2_SPTR)item, strlen(item), 0, 0, match_data, NULL);
+}
+
+static bool pattern_matches(struct pattern *pattern, const char *item) {
+	size_t len;
+	switch (pattern->literal_type) {
+	case LITERAL_NONE:
+		break;
+	case LITERAL_SUBSTRING:
+		return strstr(item, pattern->literal) != NULL;
+	case LITERAL_PREFIX:
+		return strncmp(item, pattern->literal, pattern->literal_len) == 0;
+	case LITERAL_EXACT:
+		len = strlen(item);
+		// Like pcre2, let $ match before a final newline
+		if (len > 0 && item[len - 1] == '\n' &&
+				len - 1 == pattern->literal_len) {
+			--len;
+		}
+		return len == pattern->literal_len &&
+			memcmp(item, pattern->literal, len) == 0;
+	}
+	return regex_cmp(item, pattern->regex) >= 0;
 }
 
 #if WLR_HAS_XWAYLAND
@@ -171,7 +231,7 @@ static bool criteria_matches_container(struct criteria *criteria,
 		bool exists = false;
 		struct sway_container *con = container;
 		for (int i = 0; i < con->marks->length; ++i) {
-			if (regex_cmp(con->marks->items[i], criteria->con_mark->regex) >= 0) {
+			if (pattern_matches(criteria->con_mark, con->marks->items[i])) {
 				exists = true;
 				break;
 			}
@@ -209,7 +269,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(title, criteria->title->regex) < 0) {
+			if (!pattern_matches(criteria->title, title)) {
 				return false;
 			}
 			break;
@@ -229,7 +289,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(shell, criteria->shell->regex) < 0) {
+			if (!pattern_matches(criteria->shell, shell)) {
 				return false;
 			}
 			break;
@@ -249,7 +309,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(app_id, criteria->app_id->regex) < 0) {
+			if (!pattern_matches(criteria->app_id, app_id)) {
 				return false;
 			}
 			break;
@@ -269,7 +329,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(sandbox_engine, criteria->sandbox_engine->regex) < 0) {
+			if (!pattern_matches(criteria->sandbox_engine, sandbox_engine)) {
 				return false;
 			}
 			break;
@@ -289,7 +349,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(sandbox_app_id, criteria->sandbox_app_id->regex) < 0) {
+			if (!pattern_matches(criteria->sandbox_app_id, sandbox_app_id)) {
 				return false;
 			}
 			break;
@@ -309,7 +369,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(sandbox_instance_id, criteria->sandbox_instance_id->regex) < 0) {
+			if (!pattern_matches(criteria->sandbox_instance_id, sandbox_instance_id)) {
 				return false;
 			}
 			break;
@@ -329,7 +389,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(tag, criteria->tag->regex) < 0) {
+			if (!pattern_matches(criteria->tag, tag)) {
 				return false;
 			}
 			break;
@@ -361,7 +421,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(class, criteria->class->regex) < 0) {
+			if (!pattern_matches(criteria->class, class)) {
 				return false;
 			}
 			break;
@@ -381,7 +441,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(instance, criteria->instance->regex) < 0) {
+			if (!pattern_matches(criteria->instance, instance)) {
 				return false;
 			}
 			break;
@@ -401,7 +461,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(window_role, criteria->window_role->regex) < 0) {
+			if (!pattern_matches(criteria->window_role, window_role)) {
 				return false;
 			}
 			break;
@@ -460,7 +520,7 @@ static bool criteria_matches_view(struct criteria *criteria,
 			}
 			break;
 		case PATTERN_PCRE2:
-			if (regex_cmp(ws->name, criteria->workspace->regex) < 0) {
+			if (!pattern_matches(criteria->workspace, ws->name)) {
 				return false;
 			}
 			break;
@@ -476,18 +536,275 @@ static bool criteria_matches_view(struct criteria *criteria,
 	return true;
 }
 
-list_t *criteria_for_view(struct sway_view *view, enum criteria_type types) {
-	list_t *criterias = config->criteria;
-	list_t *matches = create_list();
+/**
+ * Criteria with an exact app_id, class or instance (such as app_id="^foo$")
+ * can only match views with that value. They are indexed by it, so only the
+ * criteria for the values of a view and the unindexed criteria need to be
+ * checked against it.
+ */
+struct criteria_index_entry {
+	uint32_t hash;
+	enum criteria_field field;
+	const char *key; // borrowed from the pattern
+	size_t key_len;
+	int *positions; // in config->criteria, ascending
+	size_t positions_len, positions_cap;
+	struct criteria_index_entry *next;
+};
+
+struct criteria_index {
+	struct criteria_index_entry **buckets;
+	size_t nbuckets; // power of two
+	struct criteria_index_entry unindexed;
+	size_t indexed;
+};
+
+static struct criteria_stats criteria_stats = {0};
+
+static uint32_t criteria_index_hash(enum criteria_field field,
+		const char *key, size_t key_len) {
+	// FNV-1a over the field and the value
+	uint32_t hash = (2166136261 ^ field) * 16777619;
+	for (size_t i = 0; i < key_len; ++i) {
+		hash = (hash ^ (uint8_t)key[i]) * 16777619;
+	}
+	return hash;
+}
+
+static struct criteria_index_entry *criteria_index_find(
+		struct criteria_index *index, enum criteria_field field,
+		const char *key, size_t key_len, bool create) {
+	uint32_t hash = criteria_index_hash(field, key, key_len);
+	struct criteria_index_entry **bucket =
+		&index->buckets[hash & (index->nbuckets - 1)];
+	for (struct criteria_index_entry *entry = *bucket; entry;
+			entry = entry->next) {
+		if (entry->hash == hash && entry->field == field &&
+				entry->key_len == key_len &&
+				memcmp(entry->key, key, key_len) == 0) {
+			return entry;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+	struct criteria_index_entry *entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		return NULL;
+	}
+	entry->hash = hash;
+	entry->field = field;
+	entry->key = key;
+	entry->key_len = key_len;
+	entry->next = *bucket;
+	*bucket = entry;
+	return entry;
+}
+
+static bool criteria_index_entry_add(struct criteria_index_entry *entry,
+		int position) {
+	if (entry->positions_len == entry->positions_cap) {
+		size_t cap = entry->positions_cap ? entry->positions_cap * 2 : 4;
+		int *positions = realloc(entry->positions, cap * sizeof(int));
+		if (!positions) {
+			return false;
+		}
+		entry->positions = positions;
+		entry->positions_cap = cap;
+	}
+	entry->positions[entry->positions_len++] = position;
+	return true;
+}
+
+static struct pattern *criteria_index_key(struct criteria *criteria,
+		enum criteria_field *field) {
+	struct pattern *candidates[] = {
+		criteria->app_id,
+#if WLR_HAS_XWAYLAND
+		criteria->class,
+		criteria->instance,
+#endif
+	};
+	enum criteria_field fields[] = {
+		CF_APP_ID,
+#if WLR_HAS_XWAYLAND
+		CF_CLASS,
+		CF_INSTANCE,
+#endif
+	};
+	for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); ++i) {
+		struct pattern *pattern = candidates[i];
+		if (pattern && pattern->match_type == PATTERN_PCRE2 &&
+				pattern->literal_type == LITERAL_EXACT) {
+			*field = fields[i];
+			return pattern;
+		}
+	}
+	return NULL;
+}
+
+void criteria_index_destroy(struct criteria_index *index) {
+	if (!index) {
+		return;
+	}
+	for (size_t i = 0; i < index->nbuckets; ++i) {
+		struct criteria_index_entry *entry = index->buckets[i];
+		while (entry) {
+			struct criteria_index_entry *next = entry->next;
+			free(entry->positions);
+			free(entry);
+			entry = next;
+		}
+	}
+	free(index->unindexed.positions);
+	free(index->buckets);
+	free(index);
+}
+
+void criteria_invalidate_index(void) {
+	criteria_index_destroy(config->criteria_index);
+	config->criteria_index = NULL;
+}
+
+static struct criteria_index *criteria_index_create(list_t *criterias) {
+	struct criteria_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		return NULL;
+	}
+	index->nbuckets = 16;
+	while (index->nbuckets < (size_t)criterias->length) {
+		index->nbuckets *= 2;
+	}
+	index->buckets = calloc(index->nbuckets, sizeof(*index->buckets));
+	if (!index->buckets) {
+		free(index);
+		return NULL;
+	}
+
 	for (int i = 0; i < criterias->length; ++i) {
 		struct criteria *criteria = criterias->items[i];
-		if ((criteria->type & types) && criteria_matches_view(criteria, view)) {
+		enum criteria_field field;
+		struct pattern *key = criteria_index_key(criteria, &field);
+		struct criteria_index_entry *entry = key ?
+			criteria_index_find(index, field, key->literal,
+					key->literal_len, true) :
+			&index->unindexed;
+		if (!entry || !criteria_index_entry_add(entry, i)) {
+			sway_log(SWAY_ERROR, "Unable to allocate criteria index");
+			criteria_index_destroy(index);
+			return NULL;
+		}
+		if (key) {
+			++index->indexed;
+		}
+	}
+	return index;
+}
+
+static void criteria_index_lookup(struct criteria_index *index,
+		enum criteria_field field, const char *value,
+		struct criteria_index_entry **entries, size_t *nentries) {
+	if (!value) {
+		value = "";
+	}
+	size_t len = strlen(value);
+	struct criteria_index_entry *entry =
+		criteria_index_find(index, field, value, len, false);
+	if (entry) {
+		entries[(*nentries)++] = entry;
+	}
+	// An exact pattern also matches before a final newline
+	if (len > 0 && value[len - 1] == '\n') {
+		entry = criteria_index_find(index, field, value, len - 1, false);
+		if (entry) {
+			entries[(*nentries)++] = entry;
+		}
+	}
+}
+
+list_t *criteria_for_view_changed(struct sway_view *view,
+		enum criteria_type types, uint32_t changed) {
+	list_t *criterias = config->criteria;
+	list_t *matches = create_list();
+	if (!config->criteria_index) {
+		config->criteria_index = criteria_index_create(criterias);
+	}
+	struct criteria_index *index = config->criteria_index;
+	if (changed != CF_ALL) {
+		changed |= CF_STATE;
+	}
+	++criteria_stats.lookups;
+
+	if (!index) {
+		for (int i = 0; i < criterias->length; ++i) {
+			struct criteria *criteria = criterias->items[i];
+			if ((criteria->type & types) &&
+					(changed == CF_ALL || (criteria->fields & changed))) {
+				++criteria_stats.evaluations;
+				if (criteria_matches_view(criteria, view)) {
+					++criteria->matches;
+					list_add(matches, criteria);
+				}
+			}
+		}
+		return matches;
+	}
+
+	// Merge the unindexed criteria with those indexed by the values of the
+	// view, which are disjoint and each in config order
+	struct criteria_index_entry *entries[7] = { &index->unindexed };
+	size_t nentries = 1;
+	criteria_index_lookup(index, CF_APP_ID, view_get_app_id(view),
+			entries, &nentries);
+#if WLR_HAS_XWAYLAND
+	criteria_index_lookup(index, CF_CLASS, view_get_class(view),
+			entries, &nentries);
+	criteria_index_lookup(index, CF_INSTANCE, view_get_instance(view),
+			entries, &nentries);
+#endif
+	size_t heads[7] = {0};
+	while (true) {
+		int position = -1;
+		size_t next = 0;
+		for (size_t i = 0; i < nentries; ++i) {
+			struct criteria_index_entry *entry = entries[i];
+			if (heads[i] < entry->positions_len && (position < 0 ||
+					entry->positions[heads[i]] < position)) {
+				position = entry->positions[heads[i]];
+				next = i;
+			}
+		}
+		if (position < 0) {
+			break;
+		}
+		++heads[next];
+
+		struct criteria *criteria = criterias->items[position];
+		if (!(criteria->type & types) ||
+				(changed != CF_ALL && !(criteria->fields & changed))) {
+			continue;
+		}
+		++criteria_stats.evaluations;
+		if (criteria_matches_view(criteria, view)) {
+			++criteria->matches;
 			list_add(matches, criteria);
 		}
 	}
 	return matches;
 }
 
+list_t *criteria_for_view(struct sway_view *view, enum criteria_type types) {
+	return criteria_for_view_changed(view, types, CF_ALL);
+}
+
+void criteria_get_stats(struct criteria_stats *stats) {
+	*stats = criteria_stats;
+	struct criteria_index *index = config->criteria_index;
+	stats->indexed = index ? index->indexed : 0;
+	stats->unindexed = index ?
+		index->unindexed.positions_len : (size_t)config->criteria->length;
+}
+
 struct match_data {
 	struct criteria *criteria;
 	list_t *matches;
@@ -739,6 +1056,41 @@ static bool parse_token(struct criteria *criteria, char *name, char *value) {
 	return true;
 }
 
+static uint32_t pattern_get_fields(struct pattern *pattern,
+		enum criteria_field field) {
+	if (!pattern) {
+		return 0;
+	}
+	return pattern->match_type == PATTERN_FOCUSED ? field | CF_STATE : field;
+}
+
+// Properties which never change after a view is mapped, such as the shell or
+// pid, have no field: criteria on them are only checked against new views.
+static uint32_t criteria_get_fields(struct criteria *criteria) {
+	uint32_t fields = 0;
+	fields |= pattern_get_fields(criteria->title, CF_TITLE);
+	fields |= pattern_get_fields(criteria->shell, 0);
+	fields |= pattern_get_fields(criteria->app_id, CF_APP_ID);
+	fields |= pattern_get_fields(criteria->con_mark, CF_MARK);
+#if WLR_HAS_XWAYLAND
+	fields |= pattern_get_fields(criteria->class, CF_CLASS);
+	fields |= pattern_get_fields(criteria->instance, CF_INSTANCE);
+	fields |= pattern_get_fields(criteria->window_role, CF_WINDOW_ROLE);
+	if (criteria->window_type != ATOM_LAST) {
+		fields |= CF_WINDOW_TYPE;
+	}
+#endif
+	fields |= pattern_get_fields(criteria->sandbox_engine, 0);
+	fields |= pattern_get_fields(criteria->sandbox_app_id, 0);
+	fields |= pattern_get_fields(criteria->sandbox_instance_id, 0);
+	fields |= pattern_get_fields(criteria->tag, CF_TAG);
+	if (criteria->floating || criteria->tiling || criteria->urgent ||
+			criteria->workspace) {
+		fields |= CF_STATE;
+	}
+	return fields;
+}
+
 static void skip_spaces(char **head) {
 	while (**head == ' ') {
 		++*head;
@@ -855,6 +1207,7 @@ struct criteria *criteria_parse(char *raw, char **error_arg) {
 		*error_arg = strdup("Criteria is empty");
 		goto cleanup;
 	}
+	criteria->fields = criteria_get_fields(criteria);
 
 	++head;
 	int len = head - raw;
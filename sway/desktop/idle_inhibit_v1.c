@@ -4,14 +4,26 @@
 #include "log.h"
 #include "sway/desktop/idle_inhibit_v1.h"
 #include "sway/input/seat.h"
+#include "sway/ipc-json.h"
 #include "sway/tree/container.h"
 #include "sway/tree/view.h"
 #include "sway/server.h"
 
+// The inhibitors of a view are part of its get_tree description
+static void invalidate_inhibitor_view(struct sway_idle_inhibitor_v1 *inhibitor) {
+	struct sway_view *view = inhibitor->view;
+	if (inhibitor->mode == INHIBIT_IDLE_APPLICATION) {
+		view = view_from_wlr_surface(inhibitor->wlr_inhibitor->surface);
+	}
+	if (view && view->container) {
+		ipc_json_invalidate_node(&view->container->node);
+	}
+}
 
 static void destroy_inhibitor(struct sway_idle_inhibitor_v1 *inhibitor) {
 	wl_list_remove(&inhibitor->link);
 	wl_list_remove(&inhibitor->destroy.link);
+	invalidate_inhibitor_view(inhibitor);
 	sway_idle_inhibit_v1_check_active();
 	free(inhibitor);
 }
@@ -42,6 +54,7 @@ void handle_idle_inhibitor_v1(struct wl_listener *listener, void *data) {
 	inhibitor->destroy.notify = handle_destroy;
 	wl_signal_add(&wlr_inhibitor->events.destroy, &inhibitor->destroy);
 
+	invalidate_inhibitor_view(inhibitor);
 	sway_idle_inhibit_v1_check_active();
 }
 
@@ -70,6 +83,7 @@ void sway_idle_inhibit_v1_user_inhibitor_register(struct sway_view *view,
 	inhibitor->destroy.notify = handle_destroy;
 	wl_signal_add(&view->events.unmap, &inhibitor->destroy);
 
+	invalidate_inhibitor_view(inhibitor);
 	sway_idle_inhibit_v1_check_active();
 }
 
@@ -24,6 +24,7 @@
 #include "sway/desktop/transaction.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
+#include "sway/ipc-json.h"
 #include "sway/ipc-server.h"
 #include "sway/layers.h"
 #include "sway/output.h"
@@ -267,6 +268,134 @@ static bool output_can_tear(struct sway_output *output) {
 	return false;
 }
 
+static int64_t timespec_diff_usec(const struct timespec *a,
+		const struct timespec *b) {
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000 +
+		(a->tv_nsec - b->tv_nsec) / 1000;
+}
+
+static void output_stats_commit(struct sway_output *output,
+		const struct timespec *start, const struct timespec *built,
+		bool tearing) {
+	struct sway_output_stats *stats = &output->stats;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (stats->in_flight) {
+		// No present event was received for the previous commit
+		++stats->discarded;
+	}
+	stats->in_flight = true;
+	stats->repaint_start = *start;
+	stats->pending = (struct sway_output_frame_timing){
+		.build_usec = timespec_diff_usec(built, start),
+		.commit_usec = timespec_diff_usec(&now, built),
+	};
+	if (tearing) {
+		++stats->tearing_flips;
+	}
+}
+
+// Bounds of the margin added to the estimated render time with
+// max_render_time auto
+#define RENDER_MARGIN_MIN_USEC 1000
+// Frames needed before the render time is estimated
+#define RENDER_ESTIMATE_MIN_FRAMES 16
+
+static int cmp_uint32(const void *_a, const void *_b) {
+	uint32_t a = *(const uint32_t *)_a;
+	uint32_t b = *(const uint32_t *)_b;
+	return (a > b) - (a < b);
+}
+
+/**
+ * With max_render_time auto, render as late as the 95th percentile of the
+ * build and commit times of the recent frames allows, plus a margin. Every
+ * missed frame doubles the margin, which then decays with each frame on time.
+ */
+static void output_set_max_render_time(struct sway_output *output,
+		int max_render_time) {
+	if (output->max_render_time != max_render_time) {
+		output->max_render_time = max_render_time;
+		// Part of the output's get_tree description
+		ipc_json_invalidate_node(&output->node);
+	}
+}
+
+static void output_update_max_render_time(struct sway_output *output,
+		int refresh_nsec, bool missed) {
+	struct sway_output_stats *stats = &output->stats;
+	int64_t refresh_usec = refresh_nsec / 1000;
+	if (missed) {
+		stats->render_margin_usec *= 2;
+	} else {
+		stats->render_margin_usec -= stats->render_margin_usec / 64;
+	}
+	if (stats->render_margin_usec < RENDER_MARGIN_MIN_USEC) {
+		stats->render_margin_usec = RENDER_MARGIN_MIN_USEC;
+	} else if (stats->render_margin_usec > refresh_usec) {
+		stats->render_margin_usec = refresh_usec;
+	}
+
+	// Until there are enough samples, render right after the refresh
+	if (stats->frames_len < RENDER_ESTIMATE_MIN_FRAMES || refresh_usec <= 0) {
+		output_set_max_render_time(output, 0);
+		return;
+	}
+
+	uint32_t costs[OUTPUT_STATS_FRAMES];
+	for (size_t i = 0; i < stats->frames_len; ++i) {
+		costs[i] = stats->frames[i].build_usec + stats->frames[i].commit_usec;
+	}
+	qsort(costs, stats->frames_len, sizeof(costs[0]), cmp_uint32);
+	int64_t estimate = costs[(stats->frames_len * 95) / 100];
+
+	int64_t budget_usec = estimate + stats->render_margin_usec;
+	int max_render_time = (budget_usec + 999) / 1000;
+	output_set_max_render_time(output,
+			max_render_time < refresh_usec / 1000 ? max_render_time : 0);
+}
+
+static void output_stats_present(struct sway_output *output,
+		const struct wlr_output_event_present *event) {
+	struct sway_output_stats *stats = &output->stats;
+	if (!stats->in_flight) {
+		return;
+	}
+	stats->in_flight = false;
+	if (!event->presented) {
+		++stats->discarded;
+		return;
+	}
+
+	struct sway_output_frame_timing *frame = &stats->pending;
+	frame->present_usec =
+		timespec_diff_usec(&event->when, &stats->repaint_start);
+	bool missed = false;
+	if (stats->predicted) {
+		frame->prediction_error_usec =
+			timespec_diff_usec(&event->when, &stats->predicted_refresh);
+		missed = event->refresh > 0 &&
+			frame->prediction_error_usec >= event->refresh / 2000;
+		if (missed) {
+			++stats->missed;
+		}
+	}
+
+	stats->frames[stats->frames_pos] = *frame;
+	stats->frames_pos = (stats->frames_pos + 1) % OUTPUT_STATS_FRAMES;
+	if (stats->frames_len < OUTPUT_STATS_FRAMES) {
+		++stats->frames_len;
+	}
+	++stats->presented;
+	if (output->max_render_time_auto) {
+		output_update_max_render_time(output, event->refresh, missed);
+	}
+	if (stats->presented % OUTPUT_STATS_FRAMES == 0) {
+		ipc_event_output_stats(output);
+	}
+}
+
 static int output_repaint_timer_handler(void *data) {
 	struct sway_output *output = data;
 
@@ -275,6 +404,9 @@ static int output_repaint_timer_handler(void *data) {
 		return 0;
 	}
 
+	struct timespec repaint_start;
+	clock_gettime(CLOCK_MONOTONIC, &repaint_start);
+
 	output_configure_scene(output, &root->root_scene->tree.node, 1.0f);
 
 	struct wlr_scene_output_state_options opts = {
@@ -293,18 +425,27 @@ static int output_repaint_timer_handler(void *data) {
 		return 0;
 	}
 
+	struct timespec built;
+	clock_gettime(CLOCK_MONOTONIC, &built);
+
 	if (output_can_tear(output)) {
 		pending.tearing_page_flip = true;
+		++output->stats.tearing_requested;
 
 		if (!wlr_output_test_state(output->wlr_output, &pending)) {
 			sway_log(SWAY_DEBUG, "Output test failed on '%s', retrying without tearing page-flip",
 				output->wlr_output->name);
 			pending.tearing_page_flip = false;
+			++output->stats.tearing_fallbacks;
 		}
 	}
 
-	if (!wlr_output_commit_state(output->wlr_output, &pending)) {
+	if (wlr_output_commit_state(output->wlr_output, &pending)) {
+		output_stats_commit(output, &repaint_start, &built,
+			pending.tearing_page_flip);
+	} else {
 		sway_log(SWAY_ERROR, "Page-flip failed on output %s", output->wlr_output->name);
+		++output->stats.failed;
 	}
 	wlr_output_state_finish(&pending);
 	return 0;
@@ -317,23 +458,29 @@ static void handle_frame(struct wl_listener *listener, void *user_data) {
 		return;
 	}
 
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	const long NSEC_IN_SECONDS = 1000000000;
+	struct timespec predicted_refresh = output->last_presentation;
+	predicted_refresh.tv_nsec += output->refresh_nsec % NSEC_IN_SECONDS;
+	predicted_refresh.tv_sec += output->refresh_nsec / NSEC_IN_SECONDS;
+	if (predicted_refresh.tv_nsec >= NSEC_IN_SECONDS) {
+		predicted_refresh.tv_sec += 1;
+		predicted_refresh.tv_nsec -= NSEC_IN_SECONDS;
+	}
+
+	// Remember the prediction to measure its error once the frame is
+	// presented. After an idle period it lies in the past and is useless.
+	output->stats.predicted = output->refresh_nsec != 0 &&
+		timespec_diff_usec(&predicted_refresh, &now) >= 0;
+	output->stats.predicted_refresh = predicted_refresh;
+
 	// Compute predicted milliseconds until the next refresh. It's used for
 	// delaying both output rendering and surface frame callbacks.
 	int msec_until_refresh = 0;
 
 	if (output->max_render_time != 0) {
-		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC, &now);
-
-		const long NSEC_IN_SECONDS = 1000000000;
-		struct timespec predicted_refresh = output->last_presentation;
-		predicted_refresh.tv_nsec += output->refresh_nsec % NSEC_IN_SECONDS;
-		predicted_refresh.tv_sec += output->refresh_nsec / NSEC_IN_SECONDS;
-		if (predicted_refresh.tv_nsec >= NSEC_IN_SECONDS) {
-			predicted_refresh.tv_sec += 1;
-			predicted_refresh.tv_nsec -= NSEC_IN_SECONDS;
-		}
-
 		// If the predicted refresh time is before the current time then
 		// there's no point in delaying.
 		//
@@ -470,7 +617,11 @@ static void handle_present(struct wl_listener *listener, void *data) {
 	struct sway_output *output = wl_container_of(listener, output, present);
 	struct wlr_output_event_present *output_event = data;
 
-	if (!output->enabled || !output_event->presented) {
+	if (!output->enabled) {
+		return;
+	}
+	output_stats_present(output, output_event);
+	if (!output_event->presented) {
 		return;
 	}
 
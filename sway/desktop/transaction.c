@@ -9,6 +9,8 @@
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
+#include "sway/ipc-json.h"
+#include "sway/ipc-server.h"
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/container.h"
@@ -18,12 +20,32 @@
 #include "list.h"
 #include "log.h"
 
+#define INSTRUCTIONS_PER_BLOCK 64
+
+// Lower bound of the time waited for a client with known latency
+#define CLIENT_MIN_TIMEOUT_MS 50
+// Consecutive timeouts after which a client is considered slow
+#define CLIENT_SLOW_TIMEOUTS 3
+// Configures not waited for between two probes of a slow client
+#define CLIENT_PROBE_INTERVAL 16
+
+struct sway_transaction_instruction_block;
+
 struct sway_transaction {
 	struct wl_event_source *timer;
 	list_t *instructions;   // struct sway_transaction_instruction *
+	// Storage for the instructions, freed with the transaction
+	struct sway_transaction_instruction_block *blocks;
 	size_t num_waiting;
 	size_t num_configures;
+	size_t num_updates; // calls to transaction_commit_dirty merged into it
+	size_t timeout_ms; // longest time waited for any of the clients
 	struct timespec commit_time;
+
+	// Parts of the scene graph affected by the instructions, see
+	// transaction_mark_stale
+	list_t *stale_workspaces; // struct sway_workspace *
+	bool stale_root;
 };
 
 struct sway_transaction_instruction {
@@ -34,11 +56,42 @@ struct sway_transaction_instruction {
 		struct sway_workspace_state workspace_state;
 		struct sway_container_state container_state;
 	};
+	// The node's tree_patch description, taken when the transaction was
+	// committed, if any client is subscribed to tree_patch events
+	json_object *patch_node;
 	uint32_t serial;
 	bool server_request;
 	bool waiting;
 };
 
+struct sway_transaction_instruction_block {
+	struct sway_transaction_instruction_block *next;
+	size_t len;
+	struct sway_transaction_instruction instructions[INSTRUCTIONS_PER_BLOCK];
+};
+
+/**
+ * Allocates a zeroed instruction from the transaction's blocks, so that a
+ * large relayout doesn't need an allocation per node.
+ */
+static struct sway_transaction_instruction *instruction_alloc(
+		struct sway_transaction *transaction) {
+	struct sway_transaction_instruction_block *block = transaction->blocks;
+	if (!block || block->len == INSTRUCTIONS_PER_BLOCK) {
+		block = malloc(sizeof(*block));
+		if (!block) {
+			return NULL;
+		}
+		block->next = transaction->blocks;
+		block->len = 0;
+		transaction->blocks = block;
+	}
+	struct sway_transaction_instruction *instruction =
+		&block->instructions[block->len++];
+	memset(instruction, 0, sizeof(*instruction));
+	return instruction;
+}
+
 static struct sway_transaction *transaction_create(void) {
 	struct sway_transaction *transaction =
 		calloc(1, sizeof(struct sway_transaction));
@@ -46,6 +99,7 @@ static struct sway_transaction *transaction_create(void) {
 		return NULL;
 	}
 	transaction->instructions = create_list();
+	transaction->stale_workspaces = create_list();
 	return transaction;
 }
 
@@ -55,6 +109,7 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
 		struct sway_node *node = instruction->node;
+		json_object_put(instruction->patch_node);
 		node->ntxnrefs--;
 		if (node->instruction == instruction) {
 			node->instruction = NULL;
@@ -75,10 +130,17 @@ static void transaction_destroy(struct sway_transaction *transaction) {
 				break;
 			}
 		}
-		free(instruction);
 	}
 	list_free(transaction->instructions);
 
+	struct sway_transaction_instruction_block *block = transaction->blocks;
+	while (block) {
+		struct sway_transaction_instruction_block *next = block->next;
+		free(block);
+		block = next;
+	}
+	list_free(transaction->stale_workspaces);
+
 	if (transaction->timer) {
 		wl_event_source_remove(transaction->timer);
 	}
@@ -139,19 +201,23 @@ static void copy_workspace_state(struct sway_workspace *ws,
 static void copy_container_state(struct sway_container *container,
 		struct sway_transaction_instruction *instruction) {
 	struct sway_container_state *state = &instruction->container_state;
-
-	if (state->children) {
-		list_free(state->children);
-	}
+	list_t *children = state->children;
 
 	memcpy(state, &container->pending, sizeof(struct sway_container_state));
 
 	if (!container->view) {
 		// We store a copy of the child list to avoid having it mutated after
-		// we copy the state.
-		state->children = create_list();
-		list_cat(state->children, container->pending.children);
+		// we copy the state. The list is reused if the container is updated
+		// again before the transaction is committed.
+		if (children) {
+			children->length = 0;
+		} else {
+			children = create_list();
+		}
+		list_cat(children, container->pending.children);
+		state->children = children;
 	} else {
+		list_free(children);
 		state->children = NULL;
 	}
 
@@ -167,23 +233,15 @@ static void copy_container_state(struct sway_container *container,
 
 static void transaction_add_node(struct sway_transaction *transaction,
 		struct sway_node *node, bool server_request) {
-	struct sway_transaction_instruction *instruction = NULL;
-
 	// Check if we have an instruction for this node already, in which case we
 	// update that instead of creating a new one.
-	if (node->ntxnrefs > 0) {
-		for (int idx = 0; idx < transaction->instructions->length; idx++) {
-			struct sway_transaction_instruction *other =
-				transaction->instructions->items[idx];
-			if (other->node == node) {
-				instruction = other;
-				break;
-			}
-		}
+	struct sway_transaction_instruction *instruction = node->pending_instruction;
+	if (instruction && instruction->transaction != transaction) {
+		instruction = NULL;
 	}
 
 	if (!instruction) {
-		instruction = calloc(1, sizeof(struct sway_transaction_instruction));
+		instruction = instruction_alloc(transaction);
 		if (!sway_assert(instruction, "Unable to allocate instruction")) {
 			return;
 		}
@@ -192,6 +250,7 @@ static void transaction_add_node(struct sway_transaction *transaction,
 		instruction->server_request = server_request;
 
 		list_add(transaction->instructions, instruction);
+		node->pending_instruction = instruction;
 		node->ntxnrefs++;
 	} else if (server_request) {
 		instruction->server_request = true;
@@ -532,54 +591,57 @@ static void disable_workspace(struct sway_workspace *ws) {
 	}
 }
 
-static void arrange_output(struct sway_output *output) {
-	for (int i = 0; i < output->current.workspaces->length; i++) {
-		struct sway_workspace *child = output->current.workspaces->items[i];
-
-		bool activated = output->current.active_workspace == child && output->wlr_output->enabled;
-
-		wlr_scene_node_reparent(&child->layers.tiling->node, output->layers.tiling);
-		wlr_scene_node_reparent(&child->layers.fullscreen->node, output->layers.fullscreen);
+static void arrange_workspace(struct sway_output *output,
+		struct sway_workspace *ws) {
+	bool activated = output->current.active_workspace == ws && output->wlr_output->enabled;
 
-		for (int i = 0; i < child->current.floating->length; i++) {
-			struct sway_container *floater = child->current.floating->items[i];
-			wlr_scene_node_reparent(&floater->scene_tree->node, root->layers.floating);
-			wlr_scene_node_set_enabled(&floater->scene_tree->node, activated);
-		}
+	wlr_scene_node_reparent(&ws->layers.tiling->node, output->layers.tiling);
+	wlr_scene_node_reparent(&ws->layers.fullscreen->node, output->layers.fullscreen);
 
-		if (activated) {
-			struct sway_container *fs = child->current.fullscreen;
-			wlr_scene_node_set_enabled(&child->layers.tiling->node, !fs);
-			wlr_scene_node_set_enabled(&child->layers.fullscreen->node, fs);
+	for (int i = 0; i < ws->current.floating->length; i++) {
+		struct sway_container *floater = ws->current.floating->items[i];
+		wlr_scene_node_reparent(&floater->scene_tree->node, root->layers.floating);
+		wlr_scene_node_set_enabled(&floater->scene_tree->node, activated);
+	}
 
-			wlr_scene_node_set_enabled(&output->layers.shell_background->node, !fs);
-			wlr_scene_node_set_enabled(&output->layers.shell_bottom->node, !fs);
-			wlr_scene_node_set_enabled(&output->layers.fullscreen->node, fs);
+	if (activated) {
+		struct sway_container *fs = ws->current.fullscreen;
+		wlr_scene_node_set_enabled(&ws->layers.tiling->node, !fs);
+		wlr_scene_node_set_enabled(&ws->layers.fullscreen->node, fs);
 
-			if (fs) {
-				disable_workspace(child);
+		wlr_scene_node_set_enabled(&output->layers.shell_background->node, !fs);
+		wlr_scene_node_set_enabled(&output->layers.shell_bottom->node, !fs);
+		wlr_scene_node_set_enabled(&output->layers.fullscreen->node, fs);
 
-				wlr_scene_rect_set_size(output->fullscreen_background,
-					output->width, output->height);
+		if (fs) {
+			disable_workspace(ws);
 
-				arrange_workspace_floating(child);
-				arrange_fullscreen(child->layers.fullscreen, fs, child,
-					output->width, output->height);
-			} else {
-				struct wlr_box *area = &output->usable_area;
-				struct side_gaps *gaps = &child->current_gaps;
-				wlr_scene_node_set_position(&child->layers.tiling->node,
-					gaps->left + area->x, gaps->top + area->y);
+			wlr_scene_rect_set_size(output->fullscreen_background,
+				output->width, output->height);
 
-				arrange_workspace_tiling(child);
-				arrange_workspace_floating(child);
-			}
+			arrange_workspace_floating(ws);
+			arrange_fullscreen(ws->layers.fullscreen, fs, ws,
+				output->width, output->height);
 		} else {
-			wlr_scene_node_set_enabled(&child->layers.tiling->node, false);
-			wlr_scene_node_set_enabled(&child->layers.fullscreen->node, false);
+			struct wlr_box *area = &output->usable_area;
+			struct side_gaps *gaps = &ws->current_gaps;
+			wlr_scene_node_set_position(&ws->layers.tiling->node,
+				gaps->left + area->x, gaps->top + area->y);
 
-			disable_workspace(child);
+			arrange_workspace_tiling(ws);
+			arrange_workspace_floating(ws);
 		}
+	} else {
+		wlr_scene_node_set_enabled(&ws->layers.tiling->node, false);
+		wlr_scene_node_set_enabled(&ws->layers.fullscreen->node, false);
+
+		disable_workspace(ws);
+	}
+}
+
+static void arrange_output(struct sway_output *output) {
+	for (int i = 0; i < output->current.workspaces->length; i++) {
+		arrange_workspace(output, output->current.workspaces->items[i]);
 	}
 }
 
@@ -673,6 +735,121 @@ static void arrange_root(struct sway_root *root) {
 	arrange_popups(root->layers.popup);
 }
 
+/**
+ * Records which part of the scene graph depends on the current state of the
+ * node. Called both before and after the instruction is applied, so that the
+ * workspace a container leaves is arranged as well as the one it enters.
+ *
+ * Workspaces are the smallest unit arranged on their own: the title bars and
+ * tabs of a container depend on its siblings, and floating containers and
+ * fullscreen state are handled per workspace.
+ */
+static void transaction_mark_stale(struct sway_transaction *transaction,
+		struct sway_node *node) {
+	struct sway_workspace *ws = NULL;
+	switch (node->type) {
+	case N_ROOT:
+	case N_OUTPUT:
+		// Output positions and active workspaces are arranged by arrange_root
+		transaction->stale_root = true;
+		return;
+	case N_WORKSPACE:
+		if (node->destroying) {
+			// No longer part of any output's workspaces
+			transaction->stale_root = true;
+			return;
+		}
+		ws = node->sway_workspace;
+		break;
+	case N_CONTAINER:
+		ws = node->sway_container->current.workspace;
+		break;
+	}
+
+	if (!ws) {
+		// Containers without a workspace are in the scratchpad, which is only
+		// hidden by arrange_root. Destroyed containers have already marked the
+		// workspace they were removed from.
+		if (!node->destroying) {
+			transaction->stale_root = true;
+		}
+	} else if (!ws->node.scene_stale) {
+		ws->node.scene_stale = true;
+		list_add(transaction->stale_workspaces, ws);
+	}
+}
+
+static uint32_t scene_hash_node(uint32_t hash, struct wlr_scene_node *node) {
+	struct {
+		struct wlr_scene_node *node;
+		int type, enabled, x, y, width, height;
+	} key = {
+		.node = node,
+		.type = node->type,
+		.enabled = node->enabled,
+		.x = node->x,
+		.y = node->y,
+	};
+	if (node->type == WLR_SCENE_NODE_RECT) {
+		struct wlr_scene_rect *rect = wlr_scene_rect_from_node(node);
+		key.width = rect->width;
+		key.height = rect->height;
+	}
+
+	const unsigned char *data = (const unsigned char *)&key;
+	for (size_t i = 0; i < sizeof(key); ++i) {
+		hash = (hash ^ data[i]) * 16777619;
+	}
+
+	if (node->type == WLR_SCENE_NODE_TREE) {
+		struct wlr_scene_tree *tree = wlr_scene_tree_from_node(node);
+		struct wlr_scene_node *child;
+		wl_list_for_each(child, &tree->children, link) {
+			hash = scene_hash_node(hash, child);
+		}
+	}
+	return hash;
+}
+
+static uint32_t scene_hash(void) {
+	return scene_hash_node(2166136261u, &root->root_scene->tree.node);
+}
+
+/**
+ * Arranges the parts of the scene graph affected by the transaction after it
+ * has been applied.
+ */
+static void transaction_arrange(struct sway_transaction *transaction) {
+	if (transaction->stale_root || root->fullscreen_global ||
+			root->arranged_fullscreen_global) {
+		arrange_root(root);
+	} else {
+		for (int i = 0; i < transaction->stale_workspaces->length; ++i) {
+			struct sway_workspace *ws = transaction->stale_workspaces->items[i];
+			if (ws->current.output) {
+				arrange_workspace(ws->current.output, ws);
+			}
+		}
+		arrange_popups(root->layers.popup);
+
+		if (debug.scene_check) {
+			uint32_t incremental = scene_hash();
+			arrange_root(root);
+			if (scene_hash() != incremental) {
+				sway_log(SWAY_ERROR, "Transaction %p: arranging %d workspaces "
+						"differs from arranging the whole tree", transaction,
+						transaction->stale_workspaces->length);
+			}
+		}
+	}
+
+	for (int i = 0; i < transaction->stale_workspaces->length; ++i) {
+		struct sway_workspace *ws = transaction->stale_workspaces->items[i];
+		ws->node.scene_stale = false;
+	}
+	root->arranged_fullscreen_global = root->fullscreen_global != NULL;
+}
+
 /**
  * Apply a transaction to the "current" state of the tree.
  */
@@ -688,30 +865,55 @@ static void transaction_apply(struct sway_transaction *transaction) {
 				"(%.1f frames if 60Hz)", transaction, ms, ms / (1000.0f / 60));
 	}
 
+	// Describe the changes for tree_patch subscribers while the previous
+	// state is still available
+	json_object *changes = ipc_event_tree_patch_begin();
+
 	// Apply the instruction state to the node's current state
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
 		struct sway_node *node = instruction->node;
 
+		transaction_mark_stale(transaction, node);
+
 		switch (node->type) {
 		case N_ROOT:
 			break;
 		case N_OUTPUT:
+			if (changes) {
+				ipc_json_describe_output_patch(changes, node->sway_output,
+						&instruction->output_state, instruction->patch_node);
+			}
 			apply_output_state(node->sway_output, &instruction->output_state);
 			break;
 		case N_WORKSPACE:
+			if (changes) {
+				ipc_json_describe_workspace_patch(changes,
+						node->sway_workspace, &instruction->workspace_state,
+						instruction->patch_node);
+			}
 			apply_workspace_state(node->sway_workspace,
 					&instruction->workspace_state);
 			break;
 		case N_CONTAINER:
+			if (changes) {
+				ipc_json_describe_container_patch(changes,
+						node->sway_container, &instruction->container_state,
+						instruction->patch_node);
+			}
 			apply_container_state(node->sway_container,
 					&instruction->container_state);
 			break;
 		}
 
+		transaction_mark_stale(transaction, node);
 		node->instruction = NULL;
 	}
+
+	if (changes) {
+		ipc_event_tree_patch(changes);
+	}
 }
 
 static void transaction_commit_pending(void);
@@ -724,7 +926,7 @@ static void transaction_progress(void) {
 		return;
 	}
 	transaction_apply(server.queued_transaction);
-	arrange_root(root);
+	transaction_arrange(server.queued_transaction);
 	cursor_rebase_all();
 	transaction_destroy(server.queued_transaction);
 	server.queued_transaction = NULL;
@@ -737,10 +939,141 @@ static void transaction_progress(void) {
 	transaction_commit_pending();
 }
 
+static void handle_client_destroy(struct wl_listener *listener, void *data) {
+	struct sway_transaction_client *client =
+		wl_container_of(listener, client, client_destroy);
+	wl_list_remove(&client->link);
+	wl_list_remove(&client->client_destroy.link);
+	free(client->name);
+	free(client);
+}
+
+static struct sway_transaction_client *transaction_client_from_view(
+		struct sway_view *view, bool create) {
+	if (!view->surface) {
+		return NULL;
+	}
+	struct wl_client *wl_client =
+		wl_resource_get_client(view->surface->resource);
+	struct sway_transaction_client *client;
+	wl_list_for_each(client, &server.transaction_clients, link) {
+		if (client->client == wl_client && client->pid == view->pid) {
+			return client;
+		}
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	client = calloc(1, sizeof(*client));
+	if (!client) {
+		sway_log(SWAY_ERROR, "Unable to allocate transaction client");
+		return NULL;
+	}
+	client->client = wl_client;
+	client->pid = view->pid;
+	client->client_destroy.notify = handle_client_destroy;
+	wl_client_add_destroy_listener(wl_client, &client->client_destroy);
+	wl_list_insert(&server.transaction_clients, &client->link);
+	return client;
+}
+
+bool transaction_client_is_slow(struct sway_transaction_client *client) {
+	return client->consecutive_timeouts >= CLIENT_SLOW_TIMEOUTS;
+}
+
+size_t transaction_client_get_timeout(struct sway_transaction_client *client) {
+	if (client->acks == 0 || transaction_client_is_slow(client)) {
+		return server.txn_timeout_ms;
+	}
+	// Like a TCP retransmission timeout, leave room for the usual variation
+	int64_t usec = client->latency_usec + 4 * client->latency_var_usec;
+	size_t ms = (usec + 999) / 1000;
+	if (ms < CLIENT_MIN_TIMEOUT_MS) {
+		ms = CLIENT_MIN_TIMEOUT_MS;
+	}
+	return ms < server.txn_timeout_ms ? ms : server.txn_timeout_ms;
+}
+
+static void transaction_client_add_sample(
+		struct sway_transaction_client *client, int64_t usec) {
+	if (client->acks == 0 && client->timeouts == 0) {
+		client->latency_usec = usec;
+		client->latency_var_usec = usec / 2;
+	} else {
+		int64_t error = usec - client->latency_usec;
+		client->latency_var_usec +=
+			((error < 0 ? -error : error) - client->latency_var_usec) / 4;
+		client->latency_usec += error / 8;
+	}
+	if (usec > client->latency_max_usec) {
+		client->latency_max_usec = usec;
+	}
+}
+
+/**
+ * Decides whether the transaction waits for the view to ack its configure.
+ */
+static void transaction_wait_for_view(struct sway_transaction *transaction,
+		struct sway_transaction_instruction *instruction,
+		struct sway_view *view) {
+	size_t timeout = server.txn_timeout_ms;
+	struct sway_transaction_client *client =
+		transaction_client_from_view(view, true);
+	if (client) {
+		const char *name = view_get_app_id(view);
+		if (!name) {
+			name = view_get_class(view);
+		}
+		if (name && (!client->name || strcmp(client->name, name) != 0)) {
+			free(client->name);
+			client->name = strdup(name);
+		}
+
+		if (transaction_client_is_slow(client) &&
+				client->skipped_since_probe < CLIENT_PROBE_INTERVAL) {
+			// The view keeps showing its saved buffer until the transaction
+			// is applied, and is centered in the new size after that
+			client->skipped_since_probe++;
+			client->skipped++;
+			return;
+		}
+		client->skipped_since_probe = 0;
+		client->configures++;
+		timeout = transaction_client_get_timeout(client);
+	}
+
+	instruction->waiting = true;
+	++transaction->num_waiting;
+	if (timeout > transaction->timeout_ms) {
+		transaction->timeout_ms = timeout;
+	}
+}
+
 static int handle_timeout(void *data) {
 	struct sway_transaction *transaction = data;
 	sway_log(SWAY_DEBUG, "Transaction %p timed out (%zi waiting)",
 			transaction, transaction->num_waiting);
+	for (int i = 0; i < transaction->instructions->length; ++i) {
+		struct sway_transaction_instruction *instruction =
+			transaction->instructions->items[i];
+		if (!instruction->waiting) {
+			continue;
+		}
+		instruction->waiting = false;
+		struct sway_transaction_client *client = transaction_client_from_view(
+				instruction->node->sway_container->view, false);
+		if (client) {
+			transaction_client_add_sample(client,
+					transaction->timeout_ms * 1000);
+			client->timeouts++;
+			if (++client->consecutive_timeouts == CLIENT_SLOW_TIMEOUTS) {
+				sway_log(SWAY_INFO, "Client %s (pid %d) is slow to respond "
+						"to configures, no longer waiting for it",
+						client->name ? client->name : "unknown", client->pid);
+			}
+		}
+	}
 	transaction->num_waiting = 0;
 	transaction_progress();
 	return 0;
@@ -781,13 +1114,20 @@ static bool should_configure(struct sway_node *node,
 }
 
 static void transaction_commit(struct sway_transaction *transaction) {
-	sway_log(SWAY_DEBUG, "Transaction %p committing with %i instructions",
-			transaction, transaction->instructions->length);
+	sway_log(SWAY_DEBUG, "Transaction %p committing with %i instructions "
+			"from %zu updates", transaction, transaction->instructions->length,
+			transaction->num_updates);
 	transaction->num_waiting = 0;
+	// The pending state may move on before the transaction is applied, so
+	// describe the nodes for tree_patch while it matches the instructions
+	bool describe = ipc_event_tree_patch_wanted();
 	for (int i = 0; i < transaction->instructions->length; ++i) {
 		struct sway_transaction_instruction *instruction =
 			transaction->instructions->items[i];
 		struct sway_node *node = instruction->node;
+		if (describe && node->type != N_ROOT && !node->destroying) {
+			instruction->patch_node = ipc_json_describe_patch_node(node);
+		}
 		bool hidden = node_is_view(node) && !node->destroying &&
 			!view_is_visible(node->sway_container->view);
 		if (should_configure(node, instruction)) {
@@ -797,8 +1137,8 @@ static void transaction_commit(struct sway_transaction *transaction) {
 					instruction->container_state.content_width,
 					instruction->container_state.content_height);
 			if (!hidden) {
-				instruction->waiting = true;
-				++transaction->num_waiting;
+				transaction_wait_for_view(transaction, instruction,
+						node->sway_container->view);
 			}
 
 			view_send_frame_done(node->sway_container->view);
@@ -808,17 +1148,17 @@ static void transaction_commit(struct sway_transaction *transaction) {
 			view_save_buffer(node->sway_container->view);
 		}
 		node->instruction = instruction;
+		node->pending_instruction = NULL;
 	}
 	transaction->num_configures = transaction->num_waiting;
-	if (debug.txn_timings) {
-		clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
-	}
+	clock_gettime(CLOCK_MONOTONIC, &transaction->commit_time);
 	if (debug.noatomic) {
 		transaction->num_waiting = 0;
 	} else if (debug.txn_wait) {
 		// Force the transaction to time out even if all views are ready.
 		// We do this by inflating the waiting counter.
 		transaction->num_waiting += 1000000;
+		transaction->timeout_ms = server.txn_timeout_ms;
 	}
 
 	if (transaction->num_waiting) {
@@ -827,7 +1167,7 @@ static void transaction_commit(struct sway_transaction *transaction) {
 				handle_timeout, transaction);
 		if (transaction->timer) {
 			wl_event_source_timer_update(transaction->timer,
-					server.txn_timeout_ms);
+					transaction->timeout_ms);
 		} else {
 			sway_log_errno(SWAY_ERROR, "Unable to create transaction timer "
 					"(some imperfect frames might be rendered)");
@@ -840,6 +1180,11 @@ static void transaction_commit_pending(void) {
 	if (server.queued_transaction) {
 		return;
 	}
+	if (server.txn_commit_scheduled) {
+		wl_event_source_timer_update(server.txn_commit_timer, 0);
+		server.txn_commit_scheduled = false;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &server.txn_last_commit);
 	struct sway_transaction *transaction = server.pending_transaction;
 	server.pending_transaction = NULL;
 	server.queued_transaction = transaction;
@@ -847,28 +1192,112 @@ static void transaction_commit_pending(void) {
 	transaction_progress();
 }
 
+static int handle_commit_timer(void *data) {
+	server.txn_commit_scheduled = false;
+	if (server.pending_transaction) {
+		transaction_commit_pending();
+	}
+	return 0;
+}
+
+/**
+ * Returns the refresh interval of the fastest enabled output, which bounds
+ * how often new state can be shown anyway.
+ */
+static int64_t get_refresh_interval_nsec(void) {
+	int64_t interval = 0;
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		if (output->refresh_nsec > 0 &&
+				(interval == 0 || output->refresh_nsec < interval)) {
+			interval = output->refresh_nsec;
+		}
+	}
+	return interval ? interval : 1000000000 / 60;
+}
+
+/**
+ * Commits the pending transaction, or with transaction_coalesce, arms a timer
+ * to commit it one refresh interval after the previous commit. Updates made
+ * in the meantime, such as the rest of a burst of IPC commands or further
+ * motion of an interactive resize, are merged into the same transaction and
+ * their configures are sent together.
+ *
+ * The interval is that of the fastest output rather than of the outputs the
+ * transaction touches, since one transaction usually spans several outputs
+ * and is not aligned to any of their vblanks.
+ */
+static void transaction_schedule_commit(void) {
+	if (!config->transaction_coalesce && !debug.txn_coalesce) {
+		transaction_commit_pending();
+		return;
+	}
+	if (server.queued_transaction) {
+		// Committed by transaction_progress once the queue is free
+		return;
+	}
+	if (server.txn_commit_scheduled) {
+		// Never move the deadline later, or a steady stream of updates could
+		// keep the transaction from being committed at all
+		return;
+	}
+	if (!server.txn_commit_timer) {
+		server.txn_commit_timer = wl_event_loop_add_timer(
+				server.wl_event_loop, handle_commit_timer, NULL);
+		if (!server.txn_commit_timer) {
+			sway_log_errno(SWAY_ERROR, "Unable to create transaction "
+					"commit timer");
+			transaction_commit_pending();
+			return;
+		}
+	}
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct timespec *last = &server.txn_last_commit;
+	int64_t elapsed = (now.tv_sec - last->tv_sec) * 1000000000 +
+		(now.tv_nsec - last->tv_nsec);
+	int64_t delay = get_refresh_interval_nsec() - elapsed;
+	// Always wait at least until the current batch of events is dispatched,
+	// a zero timeout would disarm the timer
+	int delay_ms = delay > 1000000 ? (delay + 999999) / 1000000 : 1;
+	wl_event_source_timer_update(server.txn_commit_timer, delay_ms);
+	server.txn_commit_scheduled = true;
+}
+
 static void set_instruction_ready(
 		struct sway_transaction_instruction *instruction) {
 	struct sway_transaction *transaction = instruction->transaction;
 
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct timespec *start = &transaction->commit_time;
+	int64_t usec = (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+
 	if (debug.txn_timings) {
-		struct timespec now;
-		clock_gettime(CLOCK_MONOTONIC, &now);
-		struct timespec *start = &transaction->commit_time;
-		float ms = (now.tv_sec - start->tv_sec) * 1000 +
-			(now.tv_nsec - start->tv_nsec) / 1000000.0;
 		sway_log(SWAY_DEBUG, "Transaction %p: %zi/%zi ready in %.1fms (%s)",
 				transaction,
 				transaction->num_configures - transaction->num_waiting + 1,
-				transaction->num_configures, ms,
+				transaction->num_configures, usec / 1000.0,
 				instruction->node->sway_container->title);
 	}
 
 	// If the transaction has timed out then its num_waiting will be 0 already.
-	if (instruction->waiting && transaction->num_waiting > 0 &&
-			--transaction->num_waiting == 0) {
-		sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
-		wl_event_source_timer_update(transaction->timer, 0);
+	if (instruction->waiting && transaction->num_waiting > 0) {
+		instruction->waiting = false;
+		struct sway_transaction_client *client = transaction_client_from_view(
+				instruction->node->sway_container->view, false);
+		if (client) {
+			transaction_client_add_sample(client, usec);
+			client->acks++;
+			client->consecutive_timeouts = 0;
+		}
+
+		if (--transaction->num_waiting == 0) {
+			sway_log(SWAY_DEBUG, "Transaction %p is ready", transaction);
+			wl_event_source_timer_update(transaction->timer, 0);
+		}
 	}
 
 	instruction->node->instruction = NULL;
@@ -917,10 +1346,15 @@ static void _transaction_commit_dirty(bool server_request) {
 		struct sway_node *node = server.dirty_nodes->items[i];
 		transaction_add_node(server.pending_transaction, node, server_request);
 		node->dirty = false;
+		if (!node->destroying) {
+			// The node may have been reparented since it was marked dirty
+			ipc_json_invalidate_node(node);
+		}
 	}
 	server.dirty_nodes->length = 0;
+	server.pending_transaction->num_updates++;
 
-	transaction_commit_pending();
+	transaction_schedule_commit();
 }
 
 void transaction_commit_dirty(void) {
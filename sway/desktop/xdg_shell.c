@@ -6,12 +6,14 @@
 #include <wlr/types/wlr_xdg_toplevel_tag_v1.h>
 #include <wlr/util/edges.h>
 #include "log.h"
+#include "sway/criteria.h"
 #include "sway/decoration.h"
 #include "sway/scene_descriptor.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
+#include "sway/ipc-json.h"
 #include "sway/output.h"
 #include "sway/tree/arrange.h"
 #include "sway/tree/container.h"
@@ -321,6 +323,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		// containers, we resize the container to match. For tiling containers,
 		// we only recenter the surface.
 		memcpy(&view->geometry, new_geo, sizeof(struct wlr_box));
+		ipc_json_invalidate_node(&view->container->node);
 		if (container_is_floating(view->container)) {
 			view_update_size(view);
 			// Only set the toplevel size the current container actually has a size.
@@ -353,7 +356,7 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 		wl_container_of(listener, xdg_shell_view, set_title);
 	struct sway_view *view = &xdg_shell_view->view;
 	view_update_title(view, false);
-	view_execute_criteria(view);
+	view_execute_criteria(view, CF_TITLE);
 	transaction_commit_dirty();
 }
 
@@ -362,7 +365,7 @@ static void handle_set_app_id(struct wl_listener *listener, void *data) {
 		wl_container_of(listener, xdg_shell_view, set_app_id);
 	struct sway_view *view = &xdg_shell_view->view;
 	view_update_app_id(view);
-	view_execute_criteria(view);
+	view_execute_criteria(view, CF_APP_ID);
 	transaction_commit_dirty();
 }
 
@@ -598,6 +601,6 @@ void xdg_toplevel_tag_manager_v1_handle_set_tag(struct wl_listener *listener, vo
 	struct sway_xdg_shell_view *xdg_shell_view = xdg_shell_view_from_view(view);
 	free(xdg_shell_view->tag);
 	xdg_shell_view->tag = strdup(event->tag);
-	view_execute_criteria(view);
+	view_execute_criteria(view, CF_TAG);
 	transaction_commit_dirty();
 }
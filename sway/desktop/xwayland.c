@@ -9,10 +9,12 @@
 #include <wlr/xwayland.h>
 #include <xcb/xcb_icccm.h>
 #include "log.h"
+#include "sway/criteria.h"
 #include "sway/desktop/transaction.h"
 #include "sway/input/cursor.h"
 #include "sway/input/input-manager.h"
 #include "sway/input/seat.h"
+#include "sway/ipc-json.h"
 #include "sway/output.h"
 #include "sway/scene_descriptor.h"
 #include "sway/tree/arrange.h"
@@ -431,6 +433,7 @@ static void handle_commit(struct wl_listener *listener, void *data) {
 		// containers, we resize the container to match. For tiling containers,
 		// we only recenter the surface.
 		memcpy(&view->geometry, &new_geo, sizeof(struct wlr_box));
+		ipc_json_invalidate_node(&view->container->node);
 		if (container_is_floating(view->container)) {
 			view_update_size(view);
 			transaction_commit_dirty_client();
@@ -688,7 +691,7 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 		return;
 	}
 	view_update_title(view, false);
-	view_execute_criteria(view);
+	view_execute_criteria(view, CF_TITLE);
 	transaction_commit_dirty();
 }
 
@@ -700,7 +703,8 @@ static void handle_set_class(struct wl_listener *listener, void *data) {
 	if (xsurface->surface == NULL || !xsurface->surface->mapped) {
 		return;
 	}
-	view_execute_criteria(view);
+	ipc_json_invalidate_node(&view->container->node);
+	view_execute_criteria(view, CF_CLASS | CF_INSTANCE);
 	transaction_commit_dirty();
 }
 
@@ -712,7 +716,8 @@ static void handle_set_role(struct wl_listener *listener, void *data) {
 	if (xsurface->surface == NULL || !xsurface->surface->mapped) {
 		return;
 	}
-	view_execute_criteria(view);
+	ipc_json_invalidate_node(&view->container->node);
+	view_execute_criteria(view, CF_WINDOW_ROLE);
 	transaction_commit_dirty();
 }
 
@@ -749,7 +754,8 @@ static void handle_set_window_type(struct wl_listener *listener, void *data) {
 	if (xsurface->surface == NULL || !xsurface->surface->mapped) {
 		return;
 	}
-	view_execute_criteria(view);
+	ipc_json_invalidate_node(&view->container->node);
+	view_execute_criteria(view, CF_WINDOW_TYPE);
 	transaction_commit_dirty();
 }
 
@@ -156,9 +156,19 @@ static bool update_shortcut_state(struct sway_shortcut_state *state,
  * current modifiers, release state, and locked state.
  */
 static void get_active_binding(const struct sway_shortcut_state *state,
-		list_t *bindings, struct sway_binding **current_binding,
+		struct sway_binding_index *index, struct sway_binding **current_binding,
 		uint32_t modifiers, bool release, bool locked, bool inhibited,
 		const char *input, bool exact_input, xkb_layout_index_t group) {
+	if (!index) {
+		return;
+	}
+
+	// Only the bindings with matching modifiers, release flag and keys are
+	// considered, in the same order as they appear in the mode
+	list_t *bindings = create_list();
+	binding_index_get_candidates(index, modifiers, release,
+		state->pressed_keys, state->npressed, state->current_key, bindings);
+
 	for (int i = 0; i < bindings->length; ++i) {
 		struct sway_binding *binding = bindings->items[i];
 		bool binding_locked = (binding->flags & BINDING_LOCKED) != 0;
@@ -252,9 +262,10 @@ static void get_active_binding(const struct sway_shortcut_state *state,
 				(((*current_binding)->flags & BINDING_LOCKED) == locked) &&
 				(((*current_binding)->flags & BINDING_INHIBITED) == inhibited) &&
 				(*current_binding)->group == group) {
-			return; // If a perfect match is found, quit searching
+			break; // If a perfect match is found, quit searching
 		}
 	}
+	list_free(bindings);
 }
 
 /**
@@ -454,19 +465,24 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 
 	bool handled = false;
 	// Identify active release binding
+	struct sway_mode *mode = config->current_mode;
+	struct sway_binding_index *keycode_index =
+		binding_index_get(&mode->keycode_index, mode->keycode_bindings);
+	struct sway_binding_index *keysym_index =
+		binding_index_get(&mode->keysym_index, mode->keysym_bindings);
 	struct sway_binding *binding_released = NULL;
 	get_active_binding(&keyboard->state_keycodes,
-			config->current_mode->keycode_bindings, &binding_released,
+			keycode_index, &binding_released,
 			keyinfo.code_modifiers, true, locked,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_raw,
-			config->current_mode->keysym_bindings, &binding_released,
+			keysym_index, &binding_released,
 			keyinfo.raw_modifiers, true, locked,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
 	get_active_binding(&keyboard->state_keysyms_translated,
-			config->current_mode->keysym_bindings, &binding_released,
+			keysym_index, &binding_released,
 			keyinfo.translated_modifiers, true, locked,
 			shortcuts_inhibited, device_identifier,
 			exact_identifier, keyboard->effective_layout);
@@ -487,18 +503,24 @@ static void handle_key_event(struct sway_keyboard *keyboard,
 	// Identify and execute active pressed binding
 	struct sway_binding *binding = NULL;
 	if (event->state == WL_KEYBOARD_KEY_STATE_PRESSED) {
+		// The release binding executed above may have changed the bindings
+		mode = config->current_mode;
+		keycode_index =
+			binding_index_get(&mode->keycode_index, mode->keycode_bindings);
+		keysym_index =
+			binding_index_get(&mode->keysym_index, mode->keysym_bindings);
 		get_active_binding(&keyboard->state_keycodes,
-				config->current_mode->keycode_bindings, &binding,
+				keycode_index, &binding,
 				keyinfo.code_modifiers, false, locked,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_raw,
-				config->current_mode->keysym_bindings, &binding,
+				keysym_index, &binding,
 				keyinfo.raw_modifiers, false, locked,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
 		get_active_binding(&keyboard->state_keysyms_translated,
-				config->current_mode->keysym_bindings, &binding,
+				keysym_index, &binding,
 				keyinfo.translated_modifiers, false, locked,
 				shortcuts_inhibited, device_identifier,
 				exact_identifier, keyboard->effective_layout);
@@ -25,6 +25,7 @@
 #include "sway/input/seat.h"
 #include "sway/input/switch.h"
 #include "sway/input/tablet.h"
+#include "sway/ipc-json.h"
 #include "sway/ipc-server.h"
 #include "sway/layers.h"
 #include "sway/output.h"
@@ -53,6 +54,7 @@ static void seat_device_destroy(struct sway_seat_device *seat_device) {
 static void seat_node_destroy(struct sway_seat_node *seat_node) {
 	wl_list_remove(&seat_node->destroy.link);
 	wl_list_remove(&seat_node->link);
+	wl_list_remove(&seat_node->node_link);
 
 	/*
 	 * This is the only time we remove items from the focus stack without
@@ -216,21 +218,170 @@ void seat_for_each_node(struct sway_seat *seat,
 	}
 }
 
-struct sway_container *seat_get_focus_inactive_view(struct sway_seat *seat,
+static struct sway_seat_node *seat_node_find(struct sway_seat *seat,
+		struct sway_node *node) {
+	struct sway_seat_node *seat_node;
+	wl_list_for_each(seat_node, &node->seat_nodes, node_link) {
+		if (seat_node->seat == seat) {
+			return seat_node;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Finds the most recently focused of the containers, optionally including
+ * their descendants. This is equivalent to the first match when walking the
+ * focus stack, but only visits the subtree instead of every focused node.
+ */
+static void find_most_recent(struct sway_seat *seat, list_t *containers,
+		bool descend, bool views_only, struct sway_seat_node **best) {
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		if (!views_only || con->view) {
+			struct sway_seat_node *seat_node = seat_node_find(seat, &con->node);
+			if (seat_node && (!*best || seat_node->stamp > (*best)->stamp)) {
+				*best = seat_node;
+			}
+		}
+		if (descend && !con->view) {
+			find_most_recent(seat, con->pending.children, descend,
+					views_only, best);
+		}
+	}
+}
+
+/**
+ * Finds the most recently focused descendant of a workspace or container.
+ */
+static struct sway_node *find_most_recent_descendant(struct sway_seat *seat,
+		struct sway_node *ancestor, bool views_only) {
+	struct sway_seat_node *best = NULL;
+	if (ancestor->type == N_WORKSPACE) {
+		struct sway_workspace *ws = ancestor->sway_workspace;
+		find_most_recent(seat, ws->tiling, true, views_only, &best);
+		find_most_recent(seat, ws->floating, true, views_only, &best);
+	} else {
+		find_most_recent(seat, ancestor->sway_container->pending.children,
+				true, views_only, &best);
+	}
+	return best ? best->node : NULL;
+}
+
+/**
+ * The focus queries below used to walk the whole focus stack. With
+ * -Dfocus-check, each query also runs that walk and logs when the two
+ * disagree.
+ */
+static void focus_check(struct sway_seat *seat, const char *query,
+		struct sway_node *parent, struct sway_node *found,
+		struct sway_node *expected) {
+	if (found == expected) {
+		return;
+	}
+	sway_log(SWAY_ERROR, "Seat %s: %s(%s %zu) returned %s %zu, "
+			"the focus stack walk returned %s %zu", seat->wlr_seat->name,
+			query, node_type_to_str(parent->type), parent->id,
+			found ? node_type_to_str(found->type) : "none",
+			found ? found->id : 0,
+			expected ? node_type_to_str(expected->type) : "none",
+			expected ? expected->id : 0);
+}
+
+static struct sway_node *container_node(struct sway_container *con) {
+	return con ? &con->node : NULL;
+}
+
+static struct sway_node *walk_focus_inactive(struct sway_seat *seat,
+		struct sway_node *node) {
+	if (node_is_view(node)) {
+		return node;
+	}
+	struct sway_seat_node *current;
+	wl_list_for_each(current, &seat->focus_stack, link) {
+		if (node_has_ancestor(current->node, node)) {
+			return current->node;
+		}
+	}
+	return node->type == N_WORKSPACE ? node : NULL;
+}
+
+static struct sway_node *walk_focus_inactive_view(struct sway_seat *seat,
 		struct sway_node *ancestor) {
 	if (node_is_view(ancestor)) {
-		return ancestor->sway_container;
+		return ancestor;
 	}
 	struct sway_seat_node *current;
 	wl_list_for_each(current, &seat->focus_stack, link) {
 		struct sway_node *node = current->node;
 		if (node_is_view(node) && node_has_ancestor(node, ancestor)) {
-			return node->sway_container;
+			return node;
+		}
+	}
+	return NULL;
+}
+
+static struct sway_node *walk_focus_inactive_layer(struct sway_seat *seat,
+		struct sway_workspace *workspace, bool floating) {
+	struct sway_seat_node *current;
+	wl_list_for_each(current, &seat->focus_stack, link) {
+		struct sway_node *node = current->node;
+		if (node->type == N_CONTAINER &&
+				container_is_floating_or_child(node->sway_container) == floating &&
+				node->sway_container->pending.workspace == workspace) {
+			return node;
+		}
+	}
+	return NULL;
+}
+
+static struct sway_node *walk_active_tiling_child(struct sway_seat *seat,
+		struct sway_node *parent) {
+	if (node_is_view(parent)) {
+		return parent;
+	}
+	struct sway_seat_node *current;
+	wl_list_for_each(current, &seat->focus_stack, link) {
+		struct sway_node *node = current->node;
+		if (node_get_parent(node) != parent) {
+			continue;
+		}
+		if (parent->type == N_WORKSPACE &&
+				list_find(parent->sway_workspace->tiling,
+					node->sway_container) == -1) {
+			continue;
 		}
+		return node;
 	}
 	return NULL;
 }
 
+struct sway_container *seat_get_focus_inactive_view(struct sway_seat *seat,
+		struct sway_node *ancestor) {
+	if (node_is_view(ancestor)) {
+		return ancestor->sway_container;
+	}
+	struct sway_container *view = NULL;
+	if (ancestor->type == N_WORKSPACE || ancestor->type == N_CONTAINER) {
+		struct sway_node *node = find_most_recent_descendant(seat, ancestor, true);
+		view = node ? node->sway_container : NULL;
+	} else {
+		struct sway_seat_node *current;
+		wl_list_for_each(current, &seat->focus_stack, link) {
+			struct sway_node *node = current->node;
+			if (node_is_view(node) && node_has_ancestor(node, ancestor)) {
+				view = node->sway_container;
+				break;
+			}
+		}
+	}
+	if (debug.focus_check) {
+		focus_check(seat, __func__, ancestor, container_node(view),
+				walk_focus_inactive_view(seat, ancestor));
+	}
+	return view;
+}
+
 static void handle_seat_node_destroy(struct wl_listener *listener, void *data) {
 	struct sway_seat_node *seat_node =
 		wl_container_of(listener, seat_node, destroy);
@@ -331,11 +482,9 @@ static struct sway_seat_node *seat_node_from_node(
 		return NULL;
 	}
 
-	struct sway_seat_node *seat_node = NULL;
-	wl_list_for_each(seat_node, &seat->focus_stack, link) {
-		if (seat_node->node == node) {
-			return seat_node;
-		}
+	struct sway_seat_node *seat_node = seat_node_find(seat, node);
+	if (seat_node) {
+		return seat_node;
 	}
 
 	seat_node = calloc(1, sizeof(struct sway_seat_node));
@@ -347,6 +496,8 @@ static struct sway_seat_node *seat_node_from_node(
 	seat_node->node = node;
 	seat_node->seat = seat;
 	wl_list_insert(seat->focus_stack.prev, &seat_node->link);
+	wl_list_insert(&node->seat_nodes, &seat_node->node_link);
+	seat_node->stamp = --seat->focus_stamp_bottom;
 	wl_signal_add(&node->events.destroy, &seat_node->destroy);
 	seat_node->destroy.notify = handle_seat_node_destroy;
 
@@ -489,14 +640,20 @@ static void handle_request_set_primary_selection(struct wl_listener *listener,
 	wlr_seat_set_primary_selection(seat->wlr_seat, event->source, event->serial);
 }
 
+static void focus_stack_raise(struct sway_seat *seat,
+		struct sway_seat_node *seat_node) {
+	wl_list_remove(&seat_node->link);
+	wl_list_insert(&seat->focus_stack, &seat_node->link);
+	seat_node->stamp = ++seat->focus_stamp_top;
+}
+
 static void collect_focus_iter(struct sway_node *node, void *data) {
 	struct sway_seat *seat = data;
 	struct sway_seat_node *seat_node = seat_node_from_node(seat, node);
 	if (!seat_node) {
 		return;
 	}
-	wl_list_remove(&seat_node->link);
-	wl_list_insert(&seat->focus_stack, &seat_node->link);
+	focus_stack_raise(seat, seat_node);
 }
 
 static void collect_focus_workspace_iter(struct sway_workspace *workspace,
@@ -1113,17 +1270,38 @@ static void set_workspace(struct sway_seat *seat,
 }
 
 void seat_set_raw_focus(struct sway_seat *seat, struct sway_node *node) {
-	struct sway_seat_node *seat_node = seat_node_from_node(seat, node);
-	wl_list_remove(&seat_node->link);
-	wl_list_insert(&seat->focus_stack, &seat_node->link);
-	node_set_dirty(node);
-
+	struct sway_node *last_focus = seat_get_focus(seat);
 	// If focusing a scratchpad container that is fullscreen global, parent
 	// will be NULL
 	struct sway_node *parent = node_get_parent(node);
+	struct sway_node *last_active =
+		parent ? seat_get_active_tiling_child(seat, parent) : NULL;
+
+	struct sway_seat_node *seat_node = seat_node_from_node(seat, node);
+	focus_stack_raise(seat, seat_node);
+	node_set_dirty(node);
 	if (parent) {
 		node_set_dirty(parent);
 	}
+
+	// The "focused" and "focus" properties change along the old and new focus
+	// chains. Changing the active child of a parent can also show or hide
+	// the whole subtree of the previous and new one, such as the workspaces
+	// of an output or the tabs of a tabbed container.
+	if (last_focus) {
+		ipc_json_invalidate_node(last_focus);
+	}
+	ipc_json_invalidate_node(node);
+	struct sway_node *active =
+		parent ? seat_get_active_tiling_child(seat, parent) : NULL;
+	if (active != last_active) {
+		if (last_active) {
+			ipc_json_invalidate_subtree(last_active);
+		}
+		if (active) {
+			ipc_json_invalidate_subtree(active);
+		}
+	}
 }
 
 static void seat_set_workspace_focus(struct sway_seat *seat, struct sway_node *node) {
@@ -1141,6 +1319,7 @@ static void seat_set_workspace_focus(struct sway_seat *seat, struct sway_node *n
 		}
 		seat_send_unfocus(last_focus, seat);
 		sway_input_method_relay_set_focus(&seat->im_relay, NULL);
+		ipc_json_invalidate_node(last_focus);
 		seat->has_focus = false;
 		return;
 	}
@@ -1292,6 +1471,7 @@ void seat_set_focus_surface(struct sway_seat *seat,
 	if (seat->has_focus && unfocus) {
 		struct sway_node *focus = seat_get_focus(seat);
 		seat_send_unfocus(focus, seat);
+		ipc_json_invalidate_node(focus);
 		seat->has_focus = false;
 	}
 
@@ -1361,55 +1541,87 @@ void seat_unfocus_unless_client(struct sway_seat *seat, struct wl_client *client
 	}
 }
 
-struct sway_node *seat_get_focus_inactive(struct sway_seat *seat,
+static struct sway_node *get_focus_inactive(struct sway_seat *seat,
 		struct sway_node *node) {
-	if (node_is_view(node)) {
-		return node;
+	if (node->type == N_WORKSPACE || node->type == N_CONTAINER) {
+		struct sway_node *focus = find_most_recent_descendant(seat, node, false);
+		if (focus) {
+			return focus;
+		}
+		return node->type == N_WORKSPACE ? node : NULL;
 	}
+	// The root also covers global fullscreen containers, and the most recent
+	// focus is usually at the top of the stack anyway
 	struct sway_seat_node *current;
 	wl_list_for_each(current, &seat->focus_stack, link) {
 		if (node_has_ancestor(current->node, node)) {
 			return current->node;
 		}
 	}
-	if (node->type == N_WORKSPACE) {
+	return NULL;
+}
+
+struct sway_node *seat_get_focus_inactive(struct sway_seat *seat,
+		struct sway_node *node) {
+	if (node_is_view(node)) {
 		return node;
 	}
-	return NULL;
+	struct sway_node *focus = get_focus_inactive(seat, node);
+	if (debug.focus_check) {
+		focus_check(seat, __func__, node, focus,
+				walk_focus_inactive(seat, node));
+	}
+	return focus;
 }
 
 struct sway_container *seat_get_focus_inactive_tiling(struct sway_seat *seat,
 		struct sway_workspace *workspace) {
-	if (!workspace->tiling->length) {
-		return NULL;
-	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node->type == N_CONTAINER &&
-				!container_is_floating_or_child(node->sway_container) &&
-				node->sway_container->pending.workspace == workspace) {
-			return node->sway_container;
-		}
+	struct sway_seat_node *best = NULL;
+	find_most_recent(seat, workspace->tiling, true, false, &best);
+	struct sway_container *con = best ? best->node->sway_container : NULL;
+	if (debug.focus_check) {
+		focus_check(seat, __func__, &workspace->node, container_node(con),
+				walk_focus_inactive_layer(seat, workspace, false));
 	}
-	return NULL;
+	return con;
 }
 
 struct sway_container *seat_get_focus_inactive_floating(struct sway_seat *seat,
 		struct sway_workspace *workspace) {
-	if (!workspace->floating->length) {
-		return NULL;
+	struct sway_seat_node *best = NULL;
+	find_most_recent(seat, workspace->floating, true, false, &best);
+	struct sway_container *con = best ? best->node->sway_container : NULL;
+	if (debug.focus_check) {
+		focus_check(seat, __func__, &workspace->node, container_node(con),
+				walk_focus_inactive_layer(seat, workspace, true));
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node->type == N_CONTAINER &&
-				container_is_floating_or_child(node->sway_container) &&
-				node->sway_container->pending.workspace == workspace) {
-			return node->sway_container;
+	return con;
+}
+
+static struct sway_node *get_active_tiling_child(struct sway_seat *seat,
+		struct sway_node *parent) {
+	struct sway_seat_node *best = NULL;
+	switch (parent->type) {
+	case N_ROOT:
+	case N_OUTPUT:;
+		struct sway_seat_node *current;
+		wl_list_for_each(current, &seat->focus_stack, link) {
+			if (node_get_parent(current->node) == parent) {
+				return current->node;
+			}
 		}
+		return NULL;
+	case N_WORKSPACE:
+		// Only consider tiling children
+		find_most_recent(seat, parent->sway_workspace->tiling, false, false,
+				&best);
+		break;
+	case N_CONTAINER:
+		find_most_recent(seat, parent->sway_container->pending.children,
+				false, false, &best);
+		break;
 	}
-	return NULL;
+	return best ? best->node : NULL;
 }
 
 struct sway_node *seat_get_active_tiling_child(struct sway_seat *seat,
@@ -1417,22 +1629,62 @@ struct sway_node *seat_get_active_tiling_child(struct sway_seat *seat,
 	if (node_is_view(parent)) {
 		return parent;
 	}
-	struct sway_seat_node *current;
-	wl_list_for_each(current, &seat->focus_stack, link) {
-		struct sway_node *node = current->node;
-		if (node_get_parent(node) != parent) {
-			continue;
+	struct sway_node *child = get_active_tiling_child(seat, parent);
+	if (debug.focus_check) {
+		focus_check(seat, __func__, parent, child,
+				walk_active_tiling_child(seat, parent));
+	}
+	return child;
+}
+
+static int seat_node_cmp_recent(const void *a, const void *b) {
+	const struct sway_seat_node *left = *(void **)a;
+	const struct sway_seat_node *right = *(void **)b;
+	return left->stamp < right->stamp ? 1 : left->stamp > right->stamp ? -1 : 0;
+}
+
+static void add_seat_nodes(struct sway_seat *seat, list_t *containers,
+		list_t *seat_nodes) {
+	for (int i = 0; i < containers->length; ++i) {
+		struct sway_container *con = containers->items[i];
+		struct sway_seat_node *seat_node = seat_node_find(seat, &con->node);
+		if (seat_node) {
+			list_add(seat_nodes, seat_node);
 		}
-		if (parent->type == N_WORKSPACE) {
-			// Only consider tiling children
-			struct sway_workspace *ws = parent->sway_workspace;
-			if (list_find(ws->tiling, node->sway_container) == -1) {
-				continue;
+	}
+}
+
+void seat_for_each_child_in_focus_order(struct sway_seat *seat,
+		struct sway_node *parent,
+		void (*f)(struct sway_node *node, void *data), void *data) {
+	list_t *seat_nodes = create_list();
+	switch (parent->type) {
+	case N_ROOT:
+	case N_OUTPUT:;
+		struct sway_seat_node *current;
+		wl_list_for_each(current, &seat->focus_stack, link) {
+			if (node_get_parent(current->node) == parent) {
+				list_add(seat_nodes, current);
 			}
 		}
-		return node;
+		break;
+	case N_WORKSPACE:
+		add_seat_nodes(seat, parent->sway_workspace->tiling, seat_nodes);
+		add_seat_nodes(seat, parent->sway_workspace->floating, seat_nodes);
+		break;
+	case N_CONTAINER:
+		if (!parent->sway_container->view) {
+			add_seat_nodes(seat, parent->sway_container->pending.children,
+					seat_nodes);
+		}
+		break;
 	}
-	return NULL;
+	list_qsort(seat_nodes, seat_node_cmp_recent);
+	for (int i = 0; i < seat_nodes->length; ++i) {
+		struct sway_seat_node *seat_node = seat_nodes->items[i];
+		f(seat_node->node, data);
+	}
+	list_free(seat_nodes);
 }
 
 struct sway_node *seat_get_focus(struct sway_seat *seat) {
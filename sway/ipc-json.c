@@ -3,16 +3,22 @@
 #include <json.h>
 #include <libevdev/libevdev.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <wlr/config.h>
 #include <wlr/types/wlr_content_type_v1.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_ext_foreign_toplevel_list_v1.h>
 #include <xkbcommon/xkbcommon.h>
+#include "cbor.h"
 #include "config.h"
 #include "log.h"
+#include "pango.h"
 #include "sway/config.h"
+#include "sway/criteria.h"
 #include "sway/ipc-json.h"
 #include "sway/server.h"
+#include "sway/sway_text_node.h"
 #include "sway/tree/container.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
@@ -22,6 +28,7 @@
 #include "sway/input/seat.h"
 #include "wlr-layer-shell-unstable-v1-protocol.h"
 #include "sway/desktop/idle_inhibit_v1.h"
+#include "sway/desktop/transaction.h"
 
 #if WLR_HAS_LIBINPUT_BACKEND
 #include <wlr/backend/libinput.h>
@@ -783,27 +790,28 @@ struct focus_inactive_data {
 	json_object *object;
 };
 
-static void focus_inactive_children_iterator(struct sway_node *node,
+static void focus_inactive_outputs_iterator(struct sway_node *node,
 		void *_data) {
 	struct focus_inactive_data *data = _data;
 	json_object *focus = data->object;
-	if (data->node == &root->node) {
-		struct sway_output *output = node_get_output(node);
-		if (output == NULL) {
+	struct sway_output *output = node_get_output(node);
+	if (output == NULL) {
+		return;
+	}
+	size_t id = output->node.id;
+	int len = json_object_array_length(focus);
+	for (int i = 0; i < len; ++i) {
+		if ((size_t) json_object_get_int(json_object_array_get_idx(focus, i)) == id) {
 			return;
 		}
-		size_t id = output->node.id;
-		int len = json_object_array_length(focus);
-		for (int i = 0; i < len; ++i) {
-			if ((size_t) json_object_get_int(json_object_array_get_idx(focus, i)) == id) {
-				return;
-			}
-		}
-		node = &output->node;
-	} else if (node_get_parent(node) != data->node) {
-		return;
 	}
-	json_object_array_add(focus, json_object_new_int(node->id));
+	json_object_array_add(focus, json_object_new_int(id));
+}
+
+static void focus_inactive_children_iterator(struct sway_node *node,
+		void *_data) {
+	struct focus_inactive_data *data = _data;
+	json_object_array_add(data->object, json_object_new_int(node->id));
 }
 
 json_object *ipc_json_describe_node(struct sway_node *node) {
@@ -829,7 +837,12 @@ json_object *ipc_json_describe_node(struct sway_node *node) {
 		.node = node,
 		.object = focus,
 	};
-	seat_for_each_node(seat, focus_inactive_children_iterator, &data);
+	if (node == &root->node) {
+		seat_for_each_node(seat, focus_inactive_outputs_iterator, &data);
+	} else {
+		seat_for_each_child_in_focus_order(seat, node,
+				focus_inactive_children_iterator, &data);
+	}
 
 	json_object *object = ipc_json_create_node((int)node->id,
 				ipc_json_node_type_description(node->type), name, focused, focus, &box);
@@ -896,6 +909,526 @@ json_object *ipc_json_describe_node_recursive(struct sway_node *node) {
 	return object;
 }
 
+/**
+ * get_tree replies are assembled from the serialized JSON, or CBOR, cached on
+ * each node, covering that node's whole subtree. A change to a node drops the
+ * fragments of the node and its ancestors; changes which are visible in a
+ * node's descendants as well (such as visibility) drop the whole subtree.
+ */
+static struct {
+	uint64_t hits, misses, invalidations;
+} tree_stats;
+
+#define TREE_CHILDREN_MARKER "__sway_ipc_tree_children__"
+static const char tree_children_placeholder[] =
+	"\"nodes\": \"" TREE_CHILDREN_MARKER "\"";
+
+struct tree_buffer {
+	char *data;
+	size_t len, size;
+};
+
+static bool tree_buffer_append(struct tree_buffer *buf,
+		const char *data, size_t len) {
+	if (buf->len + len + 1 > buf->size) {
+		size_t size = buf->size ? buf->size : 1024;
+		while (size < buf->len + len + 1) {
+			size *= 2;
+		}
+		char *new_data = realloc(buf->data, size);
+		if (!new_data) {
+			sway_log(SWAY_ERROR, "Unable to allocate get_tree buffer");
+			return false;
+		}
+		buf->data = new_data;
+		buf->size = size;
+	}
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+	return true;
+}
+
+static const char *ipc_json_describe_node_cached(struct sway_node *node,
+		size_t *len);
+
+static bool tree_buffer_append_child(struct tree_buffer *buf,
+		struct sway_node *child, bool *first) {
+	size_t len;
+	const char *json = ipc_json_describe_node_cached(child, &len);
+	if (!json || !tree_buffer_append(buf, *first ? " " : ", ", *first ? 1 : 2)
+			|| !tree_buffer_append(buf, json, len)) {
+		return false;
+	}
+	*first = false;
+	return true;
+}
+
+// The children which are part of the cached fragments. The scratchpad output
+// of the root and the floating nodes of workspaces are described with their
+// parent instead.
+static list_t *tree_node_children(struct sway_node *node) {
+	switch (node->type) {
+	case N_ROOT:
+		return root->outputs;
+	case N_OUTPUT:
+		return node->sway_output->workspaces;
+	case N_WORKSPACE:
+		return node->sway_workspace->tiling;
+	case N_CONTAINER:
+		return node->sway_container->pending.children;
+	}
+	return NULL;
+}
+
+static struct sway_node *tree_node_child(struct sway_node *node, int i) {
+	void *child = tree_node_children(node)->items[i];
+	switch (node->type) {
+	case N_ROOT:
+		return &((struct sway_output *)child)->node;
+	case N_OUTPUT:
+		return &((struct sway_workspace *)child)->node;
+	case N_WORKSPACE:
+	case N_CONTAINER:
+		break;
+	}
+	return &((struct sway_container *)child)->node;
+}
+
+static bool tree_buffer_append_children(struct tree_buffer *buf,
+		struct sway_node *node) {
+	bool first = true;
+	if (node->type == N_ROOT) {
+		// The scratchpad output is synthesized, so it is never cached
+		json_object *scratchpad = ipc_json_describe_scratchpad_output();
+		size_t len;
+		const char *json = json_object_to_json_string_length(scratchpad,
+				JSON_C_TO_STRING_SPACED, &len);
+		bool success = tree_buffer_append(buf, " ", 1) &&
+			tree_buffer_append(buf, json, len);
+		json_object_put(scratchpad);
+		if (!success) {
+			return false;
+		}
+		first = false;
+	}
+	list_t *children = tree_node_children(node);
+	for (int i = 0; children && i < children->length; ++i) {
+		if (!tree_buffer_append_child(buf, tree_node_child(node, i), &first)) {
+			return false;
+		}
+	}
+	// Matches json-c's spaced array formatting, including "[ ]" when empty
+	return tree_buffer_append(buf, " ]", 2);
+}
+
+static const char *ipc_json_describe_node_cached(struct sway_node *node,
+		size_t *len) {
+	if (node->ipc_json) {
+		tree_stats.hits++;
+		*len = node->ipc_json_len;
+		return node->ipc_json;
+	}
+	tree_stats.misses++;
+
+	// Serialize the node itself with a placeholder in place of its children,
+	// then splice in the children's own cached fragments. Quotes inside JSON
+	// strings are always escaped, so the placeholder can only match the key.
+	json_object *object = ipc_json_describe_node(node);
+	json_object_object_add(object, "nodes",
+			json_object_new_string(TREE_CHILDREN_MARKER));
+	size_t object_len;
+	const char *json = json_object_to_json_string_length(object,
+			JSON_C_TO_STRING_SPACED, &object_len);
+	const char *placeholder = strstr(json, tree_children_placeholder);
+	if (!sway_assert(placeholder, "Missing get_tree children placeholder")) {
+		json_object_put(object);
+		return NULL;
+	}
+	size_t prefix_len = placeholder - json + strlen("\"nodes\": ");
+	const char *suffix = placeholder + strlen(tree_children_placeholder);
+
+	struct tree_buffer buf = {0};
+	bool success = tree_buffer_append(&buf, json, prefix_len) &&
+		tree_buffer_append(&buf, "[", 1) &&
+		tree_buffer_append_children(&buf, node) &&
+		tree_buffer_append(&buf, suffix, object_len - (suffix - json));
+	json_object_put(object);
+	if (!success) {
+		free(buf.data);
+		return NULL;
+	}
+
+	free(node->ipc_json);
+	node->ipc_json = buf.data;
+	node->ipc_json_len = buf.len;
+	*len = buf.len;
+	return buf.data;
+}
+
+const char *ipc_json_get_tree(size_t *len) {
+	return ipc_json_describe_node_cached(&root->node, len);
+}
+
+static const uint8_t *ipc_cbor_describe_node_cached(struct sway_node *node,
+		size_t *len) {
+	if (node->ipc_cbor) {
+		tree_stats.hits++;
+		*len = node->ipc_cbor_len;
+		return node->ipc_cbor;
+	}
+	tree_stats.misses++;
+
+	// Encode the node itself with an empty "nodes" array moved to its last
+	// member, then replace the array with one holding the children's own
+	// cached fragments. An empty array is encoded as the single byte 0x80.
+	json_object *object = ipc_json_describe_node(node);
+	json_object_object_del(object, "nodes");
+	json_object_object_add(object, "nodes", json_object_new_array());
+	struct cbor_writer writer = {0};
+	cbor_write_json(&writer, object);
+	json_object_put(object);
+	if (writer.failed || !sway_assert(writer.data[writer.len - 1] == 0x80,
+				"Missing get_tree children array")) {
+		free(writer.data);
+		return NULL;
+	}
+	writer.len--;
+
+	list_t *children = tree_node_children(node);
+	int length = children ? children->length : 0;
+	if (node->type == N_ROOT) {
+		// The scratchpad output is synthesized, so it is never cached
+		cbor_write_array(&writer, length + 1);
+		json_object *scratchpad = ipc_json_describe_scratchpad_output();
+		cbor_write_json(&writer, scratchpad);
+		json_object_put(scratchpad);
+	} else {
+		cbor_write_array(&writer, length);
+	}
+	for (int i = 0; i < length; ++i) {
+		size_t child_len;
+		const uint8_t *child =
+			ipc_cbor_describe_node_cached(tree_node_child(node, i), &child_len);
+		if (!child) {
+			free(writer.data);
+			return NULL;
+		}
+		cbor_write_raw(&writer, child, child_len);
+	}
+	if (writer.failed) {
+		free(writer.data);
+		return NULL;
+	}
+
+	free(node->ipc_cbor);
+	node->ipc_cbor = writer.data;
+	node->ipc_cbor_len = writer.len;
+	*len = writer.len;
+	return writer.data;
+}
+
+const uint8_t *ipc_json_get_tree_cbor(size_t *len) {
+	return ipc_cbor_describe_node_cached(&root->node, len);
+}
+
+static void tree_node_drop_cache(struct sway_node *node) {
+	free(node->ipc_json);
+	node->ipc_json = NULL;
+	free(node->ipc_cbor);
+	node->ipc_cbor = NULL;
+}
+
+void ipc_json_invalidate_node(struct sway_node *node) {
+	tree_stats.invalidations++;
+	for (; node; node = node_get_parent(node)) {
+		tree_node_drop_cache(node);
+	}
+	// Hidden scratchpad containers have no parent but are part of the tree
+	if (root) {
+		tree_node_drop_cache(&root->node);
+	}
+}
+
+static void invalidate_descendants(struct sway_node *node) {
+	int i;
+	switch (node->type) {
+	case N_ROOT:
+		for (i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			invalidate_descendants(&output->node);
+		}
+		break;
+	case N_OUTPUT:
+		for (i = 0; i < node->sway_output->workspaces->length; ++i) {
+			struct sway_workspace *ws = node->sway_output->workspaces->items[i];
+			invalidate_descendants(&ws->node);
+		}
+		break;
+	case N_WORKSPACE:
+		for (i = 0; i < node->sway_workspace->tiling->length; ++i) {
+			struct sway_container *con = node->sway_workspace->tiling->items[i];
+			invalidate_descendants(&con->node);
+		}
+		for (i = 0; i < node->sway_workspace->floating->length; ++i) {
+			struct sway_container *con = node->sway_workspace->floating->items[i];
+			invalidate_descendants(&con->node);
+		}
+		break;
+	case N_CONTAINER:
+		if (node->sway_container->pending.children) {
+			for (i = 0; i < node->sway_container->pending.children->length; ++i) {
+				struct sway_container *child =
+					node->sway_container->pending.children->items[i];
+				invalidate_descendants(&child->node);
+			}
+		}
+		break;
+	}
+	tree_node_drop_cache(node);
+}
+
+void ipc_json_invalidate_subtree(struct sway_node *node) {
+	invalidate_descendants(node);
+	ipc_json_invalidate_node(node);
+}
+
+/**
+ * tree_patch changes describe the state a node was given by a transaction,
+ * rather than a difference to its previous state, so that applying one to a
+ * replica which already reflects it is harmless.
+ */
+static json_object *tree_patch_change(const char *change,
+		struct sway_node *node) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "change", json_object_new_string(change));
+	json_object_object_add(object, "id", json_object_new_int(node->id));
+	return object;
+}
+
+json_object *ipc_json_describe_patch_node(struct sway_node *node) {
+	json_object *object = ipc_json_describe_node(node);
+	// The structure of the tree is described by children changes
+	json_object_object_del(object, "nodes");
+	json_object_object_del(object, "floating_nodes");
+	return object;
+}
+
+static void tree_patch_copy_properties(json_object *change,
+		json_object *node, const char *properties[]) {
+	for (size_t i = 0; properties[i]; ++i) {
+		json_object *value = NULL;
+		json_object_object_get_ex(node, properties[i], &value);
+		json_object_object_add(change, properties[i], json_object_get(value));
+	}
+}
+
+static json_object *tree_patch_id_array(list_t *nodes) {
+	json_object *array = json_object_new_array();
+	for (int i = 0; nodes && i < nodes->length; ++i) {
+		struct sway_node *node = nodes->items[i];
+		json_object_array_add(array, json_object_new_int(node->id));
+	}
+	return array;
+}
+
+static bool tree_patch_lists_equal(list_t *a, list_t *b) {
+	int a_len = a ? a->length : 0;
+	int b_len = b ? b->length : 0;
+	return a_len == b_len && (a_len == 0 ||
+			memcmp(a->items, b->items, a_len * sizeof(void *)) == 0);
+}
+
+struct tree_patch_flags {
+	bool new, move, geometry, focus, property, children;
+};
+
+static void tree_patch_add(json_object *changes, struct sway_node *node,
+		json_object *described, struct tree_patch_flags *flags, int parent_id,
+		json_object *children) {
+	json_object *object = NULL;
+	if (flags->new || flags->geometry || flags->focus || flags->property) {
+		object = described ? json_object_get(described) :
+			ipc_json_describe_patch_node(node);
+	}
+
+	json_object *change;
+	if (flags->new) {
+		change = tree_patch_change("new", node);
+		json_object_object_add(change, "parent", json_object_new_int(parent_id));
+		json_object_object_add(change, "node", json_object_get(object));
+		json_object_array_add(changes, change);
+	} else {
+		if (flags->move) {
+			change = tree_patch_change("move", node);
+			json_object_object_add(change, "parent",
+					json_object_new_int(parent_id));
+			json_object_array_add(changes, change);
+		}
+		if (flags->property) {
+			change = tree_patch_change("property", node);
+			json_object_object_add(change, "node", json_object_get(object));
+			json_object_array_add(changes, change);
+		} else {
+			if (flags->geometry) {
+				static const char *geometry[] = {
+					"rect", "deco_rect", "window_rect", "geometry", NULL,
+				};
+				change = tree_patch_change("geometry", node);
+				tree_patch_copy_properties(change, object, geometry);
+				json_object_array_add(changes, change);
+			}
+			if (flags->focus) {
+				static const char *focus[] = { "focused", "focus", NULL };
+				change = tree_patch_change("focus", node);
+				tree_patch_copy_properties(change, object, focus);
+				json_object_array_add(changes, change);
+			}
+		}
+	}
+	if (children) {
+		json_object_array_add(changes, children);
+	}
+	json_object_put(object);
+}
+
+static json_object *tree_patch_children(struct sway_node *node,
+		list_t *nodes, list_t *floating_nodes) {
+	json_object *change = tree_patch_change("children", node);
+	json_object_object_add(change, "nodes", tree_patch_id_array(nodes));
+	if (node->type == N_WORKSPACE) {
+		json_object_object_add(change, "floating_nodes",
+				tree_patch_id_array(floating_nodes));
+	}
+	return change;
+}
+
+void ipc_json_describe_output_patch(json_object *changes,
+		struct sway_output *output, struct sway_output_state *state,
+		json_object *described) {
+	struct sway_output_state *current = &output->current;
+	if (output->node.destroying) {
+		json_object_array_add(changes,
+				tree_patch_change("close", &output->node));
+		return;
+	}
+	struct tree_patch_flags flags = {
+		.new = current->active_workspace == NULL && state->active_workspace,
+		.property = current->active_workspace != state->active_workspace,
+		.children = !tree_patch_lists_equal(current->workspaces,
+				state->workspaces),
+	};
+	if (!flags.new && !flags.property && !flags.children) {
+		return;
+	}
+	tree_patch_add(changes, &output->node, described, &flags, root->node.id,
+			flags.children ? tree_patch_children(&output->node,
+				state->workspaces, NULL) : NULL);
+	if (flags.new) {
+		json_object *change = tree_patch_change("children", &root->node);
+		json_object *outputs = json_object_new_array();
+		json_object_array_add(outputs, json_object_new_int(i3_output_id));
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *other = root->outputs->items[i];
+			json_object_array_add(outputs, json_object_new_int(other->node.id));
+		}
+		json_object_object_add(change, "nodes", outputs);
+		json_object_array_add(changes, change);
+	}
+}
+
+void ipc_json_describe_workspace_patch(json_object *changes,
+		struct sway_workspace *ws, struct sway_workspace_state *state,
+		json_object *described) {
+	struct sway_workspace_state *current = &ws->current;
+	if (ws->node.destroying) {
+		json_object_array_add(changes, tree_patch_change("close", &ws->node));
+		return;
+	}
+	bool new = current->output == NULL;
+	struct tree_patch_flags flags = {
+		.new = new,
+		.move = !new && current->output != state->output,
+		.geometry = current->x != state->x || current->y != state->y ||
+			current->width != state->width ||
+			current->height != state->height,
+		.focus = current->focused != state->focused ||
+			current->focused_inactive_child != state->focused_inactive_child,
+		.property = current->layout != state->layout ||
+			current->fullscreen != state->fullscreen,
+		.children = !tree_patch_lists_equal(current->tiling, state->tiling) ||
+			!tree_patch_lists_equal(current->floating, state->floating),
+	};
+	if (!flags.new && !flags.move && !flags.geometry && !flags.focus &&
+			!flags.property && !flags.children) {
+		return;
+	}
+	int parent_id = state->output ? (int)state->output->node.id : i3_output_id;
+	tree_patch_add(changes, &ws->node, described, &flags, parent_id,
+			flags.children ? tree_patch_children(&ws->node,
+				state->tiling, state->floating) : NULL);
+}
+
+static int container_state_parent_id(struct sway_container_state *state) {
+	if (state->parent) {
+		return state->parent->node.id;
+	} else if (state->workspace) {
+		return state->workspace->node.id;
+	}
+	// Hidden in the scratchpad
+	return i3_scratch_id;
+}
+
+void ipc_json_describe_container_patch(json_object *changes,
+		struct sway_container *con, struct sway_container_state *state,
+		json_object *described) {
+	struct sway_container_state *current = &con->current;
+	if (con->node.destroying) {
+		json_object_array_add(changes, tree_patch_change("close", &con->node));
+		return;
+	}
+	// A container which has never been applied has an all zero current state
+	bool new = !current->workspace && !current->parent &&
+		current->width == 0 && current->height == 0;
+	struct tree_patch_flags flags = {
+		.new = new,
+		.move = !new && (current->parent != state->parent ||
+			current->workspace != state->workspace),
+		.geometry = current->x != state->x || current->y != state->y ||
+			current->width != state->width ||
+			current->height != state->height ||
+			current->content_x != state->content_x ||
+			current->content_y != state->content_y ||
+			current->content_width != state->content_width ||
+			current->content_height != state->content_height,
+		.focus = current->focused != state->focused ||
+			current->focused_inactive_child != state->focused_inactive_child,
+		.property = current->layout != state->layout ||
+			current->fullscreen_mode != state->fullscreen_mode ||
+			current->border != state->border ||
+			current->border_thickness != state->border_thickness ||
+			current->border_top != state->border_top ||
+			current->border_bottom != state->border_bottom ||
+			current->border_left != state->border_left ||
+			current->border_right != state->border_right,
+		.children = !con->view &&
+			!tree_patch_lists_equal(current->children, state->children),
+	};
+	if (!flags.new && !flags.move && !flags.geometry && !flags.focus &&
+			!flags.property && !flags.children) {
+		return;
+	}
+	tree_patch_add(changes, &con->node, described, &flags,
+			container_state_parent_id(state), flags.children ?
+			tree_patch_children(&con->node, state->children, NULL) : NULL);
+}
+
+void ipc_json_describe_property_patch(json_object *changes,
+		struct sway_node *node) {
+	struct tree_patch_flags flags = { .property = true };
+	tree_patch_add(changes, node, NULL, &flags, 0, NULL);
+}
+
 #if WLR_HAS_LIBINPUT_BACKEND
 static json_object *describe_libinput_device(struct libinput_device *device) {
 	json_object *object = json_object_new_object();
@@ -1301,6 +1834,8 @@ json_object *ipc_json_describe_bar_config(struct bar_config *bar) {
 			json_object_new_int(bar->status_padding));
 	json_object_object_add(json, "status_edge_padding",
 			json_object_new_int(bar->status_edge_padding));
+	json_object_object_add(json, "status_max_fps",
+			json_object_new_int(bar->status_max_fps));
 	json_object_object_add(json, "wrap_scroll",
 			json_object_new_boolean(bar->wrap_scroll));
 	json_object_object_add(json, "workspace_buttons",
@@ -1479,3 +2014,229 @@ json_object *ipc_json_get_binding_mode(void) {
 			json_object_new_string(config->current_mode->name));
 	return current_mode;
 }
+
+static json_object *ipc_json_describe_text_cache(void) {
+	struct sway_text_cache_stats stats;
+	sway_text_node_get_cache_stats(&stats);
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "hits", json_object_new_int64(stats.hits));
+	json_object_object_add(object, "misses", json_object_new_int64(stats.misses));
+	json_object_object_add(object, "evictions",
+			json_object_new_int64(stats.evictions));
+	json_object_object_add(object, "entries",
+			json_object_new_int64(stats.entries));
+	json_object_object_add(object, "bytes", json_object_new_int64(stats.bytes));
+	return object;
+}
+
+static json_object *ipc_json_describe_text_layout(void) {
+	struct text_stats stats;
+	get_text_stats(&stats);
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "measure_hits",
+			json_object_new_int64(stats.measure_hits));
+	json_object_object_add(object, "measure_misses",
+			json_object_new_int64(stats.measure_misses));
+	json_object_object_add(object, "measure_entries",
+			json_object_new_int64(stats.measure_entries));
+	json_object_object_add(object, "renders",
+			json_object_new_int64(stats.renders));
+	json_object_object_add(object, "contexts_created",
+			json_object_new_int64(stats.contexts_created));
+	return object;
+}
+
+static json_object *ipc_json_describe_tree_stats(void) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "hits",
+			json_object_new_int64(tree_stats.hits));
+	json_object_object_add(object, "misses",
+			json_object_new_int64(tree_stats.misses));
+	json_object_object_add(object, "invalidations",
+			json_object_new_int64(tree_stats.invalidations));
+	return object;
+}
+
+static int cmp_int64(const void *_a, const void *_b) {
+	int64_t a = *(const int64_t *)_a;
+	int64_t b = *(const int64_t *)_b;
+	return (a > b) - (a < b);
+}
+
+// Sorts the values in place
+static json_object *ipc_json_describe_frame_timings(int64_t *values,
+		size_t len) {
+	json_object *object = json_object_new_object();
+	int64_t min = 0, max = 0, avg = 0, p50 = 0, p99 = 0;
+	if (len > 0) {
+		qsort(values, len, sizeof(*values), cmp_int64);
+		int64_t sum = 0;
+		for (size_t i = 0; i < len; ++i) {
+			sum += values[i];
+		}
+		min = values[0];
+		max = values[len - 1];
+		avg = sum / (int64_t)len;
+		p50 = values[len / 2];
+		p99 = values[(len * 99) / 100];
+	}
+	json_object_object_add(object, "min", json_object_new_int64(min));
+	json_object_object_add(object, "avg", json_object_new_int64(avg));
+	json_object_object_add(object, "p50", json_object_new_int64(p50));
+	json_object_object_add(object, "p99", json_object_new_int64(p99));
+	json_object_object_add(object, "max", json_object_new_int64(max));
+	return object;
+}
+
+json_object *ipc_json_describe_output_stats(struct sway_output *output) {
+	struct sway_output_stats *stats = &output->stats;
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "name",
+			json_object_new_string(output->wlr_output->name));
+	json_object_object_add(object, "refresh",
+			json_object_new_int64(output->refresh_nsec));
+	json_object_object_add(object, "max_render_time",
+			json_object_new_int(output->max_render_time));
+	json_object_object_add(object, "max_render_time_auto",
+			json_object_new_boolean(output->max_render_time_auto));
+	json_object_object_add(object, "render_margin",
+			json_object_new_int64(stats->render_margin_usec));
+	json_object_object_add(object, "presented",
+			json_object_new_int64(stats->presented));
+	json_object_object_add(object, "missed",
+			json_object_new_int64(stats->missed));
+	json_object_object_add(object, "discarded",
+			json_object_new_int64(stats->discarded));
+	json_object_object_add(object, "failed",
+			json_object_new_int64(stats->failed));
+
+	json_object *tearing = json_object_new_object();
+	json_object_object_add(tearing, "requested",
+			json_object_new_int64(stats->tearing_requested));
+	json_object_object_add(tearing, "fallbacks",
+			json_object_new_int64(stats->tearing_fallbacks));
+	json_object_object_add(tearing, "flips",
+			json_object_new_int64(stats->tearing_flips));
+	json_object_object_add(object, "tearing", tearing);
+
+	int64_t build[OUTPUT_STATS_FRAMES], commit[OUTPUT_STATS_FRAMES],
+		present[OUTPUT_STATS_FRAMES], prediction[OUTPUT_STATS_FRAMES];
+	size_t len = stats->frames_len;
+	for (size_t i = 0; i < len; ++i) {
+		struct sway_output_frame_timing *frame = &stats->frames[i];
+		build[i] = frame->build_usec;
+		commit[i] = frame->commit_usec;
+		present[i] = frame->present_usec;
+		prediction[i] = frame->prediction_error_usec;
+	}
+	json_object_object_add(object, "frames", json_object_new_int64(len));
+	json_object_object_add(object, "build",
+			ipc_json_describe_frame_timings(build, len));
+	json_object_object_add(object, "commit",
+			ipc_json_describe_frame_timings(commit, len));
+	json_object_object_add(object, "present",
+			ipc_json_describe_frame_timings(present, len));
+	json_object_object_add(object, "prediction_error",
+			ipc_json_describe_frame_timings(prediction, len));
+	return object;
+}
+
+static json_object *ipc_json_describe_transaction_client(
+		struct sway_transaction_client *client) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "pid", json_object_new_int(client->pid));
+	json_object_object_add(object, "name",
+			client->name ? json_object_new_string(client->name) : NULL);
+	json_object_object_add(object, "slow",
+			json_object_new_boolean(transaction_client_is_slow(client)));
+	json_object_object_add(object, "timeout",
+			json_object_new_int64(transaction_client_get_timeout(client)));
+	json_object_object_add(object, "configures",
+			json_object_new_int64(client->configures));
+	json_object_object_add(object, "acks",
+			json_object_new_int64(client->acks));
+	json_object_object_add(object, "timeouts",
+			json_object_new_int64(client->timeouts));
+	json_object_object_add(object, "skipped",
+			json_object_new_int64(client->skipped));
+
+	json_object *latency = json_object_new_object();
+	json_object_object_add(latency, "avg",
+			json_object_new_int64(client->latency_usec));
+	json_object_object_add(latency, "dev",
+			json_object_new_int64(client->latency_var_usec));
+	json_object_object_add(latency, "max",
+			json_object_new_int64(client->latency_max_usec));
+	json_object_object_add(object, "latency", latency);
+	return object;
+}
+
+json_object *ipc_json_get_transaction_stats(void) {
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "timeout",
+			json_object_new_int64(server.txn_timeout_ms));
+
+	json_object *clients = json_object_new_array();
+	struct sway_transaction_client *client;
+	wl_list_for_each(client, &server.transaction_clients, link) {
+		json_object_array_add(clients,
+				ipc_json_describe_transaction_client(client));
+	}
+	json_object_object_add(object, "clients", clients);
+	return object;
+}
+
+static const char *ipc_json_criteria_type_description(enum criteria_type type) {
+	switch (type) {
+	case CT_COMMAND:
+		return "for_window";
+	case CT_ASSIGN_OUTPUT:
+	case CT_ASSIGN_WORKSPACE:
+	case CT_ASSIGN_WORKSPACE_NUMBER:
+		return "assign";
+	case CT_NO_FOCUS:
+		return "no_focus";
+	}
+	return "unknown";
+}
+
+static json_object *ipc_json_describe_criteria_stats(void) {
+	struct criteria_stats stats;
+	criteria_get_stats(&stats);
+
+	json_object *object = json_object_new_object();
+	json_object_object_add(object, "lookups",
+			json_object_new_int64(stats.lookups));
+	json_object_object_add(object, "evaluations",
+			json_object_new_int64(stats.evaluations));
+	json_object_object_add(object, "indexed",
+			json_object_new_int64(stats.indexed));
+	json_object_object_add(object, "unindexed",
+			json_object_new_int64(stats.unindexed));
+
+	json_object *rules = json_object_new_array();
+	for (int i = 0; i < config->criteria->length; ++i) {
+		struct criteria *criteria = config->criteria->items[i];
+		json_object *rule = json_object_new_object();
+		json_object_object_add(rule, "type", json_object_new_string(
+				ipc_json_criteria_type_description(criteria->type)));
+		json_object_object_add(rule, "criteria",
+				json_object_new_string(criteria->raw));
+		json_object_object_add(rule, "matches",
+				json_object_new_int64(criteria->matches));
+		json_object_array_add(rules, rule);
+	}
+	json_object_object_add(object, "rules", rules);
+	return object;
+}
+
+json_object *ipc_json_get_stats(void) {
+	json_object *stats = json_object_new_object();
+	json_object_object_add(stats, "text_cache", ipc_json_describe_text_cache());
+	json_object_object_add(stats, "text_layout", ipc_json_describe_text_layout());
+	json_object_object_add(stats, "tree", ipc_json_describe_tree_stats());
+	json_object_object_add(stats, "criteria", ipc_json_describe_criteria_stats());
+	return stats;
+}
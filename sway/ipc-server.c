@@ -11,6 +11,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
@@ -27,6 +28,7 @@
 #include "sway/tree/root.h"
 #include "sway/tree/view.h"
 #include "sway/tree/workspace.h"
+#include "cbor.h"
 #include "list.h"
 #include "log.h"
 #include "util.h"
@@ -41,20 +43,72 @@ static const char ipc_magic[] = {'i', '3', '-', 'i', 'p', 'c'};
 
 #define IPC_HEADER_SIZE (sizeof(ipc_magic) + 8)
 
+// Clients which fall this far behind reading their replies and events are
+// disconnected
+#define IPC_CLIENT_MAX_QUEUED (4 * 1024 * 1024)
+// Maximum number of messages passed to a single writev call
+#define IPC_WRITE_BATCH 64
+
+/**
+ * A serialized message. Events are serialized once and the same segment is
+ * queued for every subscribed client.
+ */
+struct ipc_segment {
+	int refs;
+	char header[IPC_HEADER_SIZE];
+	json_object *json; // owns the payload if set
+	uint8_t *cbor; // owns the payload if set
+	const char *payload;
+	uint32_t payload_length;
+	char data[]; // holds the payload if neither json nor cbor is set
+};
+
+enum ipc_encoding {
+	IPC_ENCODING_JSON,
+	IPC_ENCODING_CBOR,
+	IPC_ENCODING_COUNT,
+};
+
+static const char *ipc_encoding_names[] = {
+	[IPC_ENCODING_JSON] = "json",
+	[IPC_ENCODING_CBOR] = "cbor",
+};
+
+struct ipc_write_queue {
+	struct ipc_segment **segments; // ring buffer
+	size_t head, len, cap;
+	size_t offset; // bytes of the head segment which have been written
+	size_t bytes; // bytes left to write
+};
+
+struct ipc_client_stats {
+	uint64_t messages_queued;
+	uint64_t bytes_written;
+	uint64_t writes;
+	uint64_t partial_writes;
+	size_t max_queued_bytes;
+};
+
 struct ipc_client {
 	struct wl_event_source *event_source;
 	struct wl_event_source *writable_event_source;
 	struct sway_server *server;
 	int fd;
 	enum ipc_command_type subscribed_events;
-	size_t write_buffer_len;
-	size_t write_buffer_size;
-	char *write_buffer;
+	enum ipc_encoding encoding;
+	struct ipc_write_queue queue;
+	struct ipc_client_stats stats;
 	// The following are for storing data between event_loop calls
 	uint32_t pending_length;
 	enum ipc_command_type pending_type;
 };
 
+// Number of clients disconnected because their queue was full
+static uint64_t ipc_clients_dropped = 0;
+
+// Serial of the last tree_patch event sent
+static uint64_t tree_patch_serial = 0;
+
 int ipc_handle_connection(int fd, uint32_t mask, void *data);
 int ipc_client_handle_readable(int client_fd, uint32_t mask, void *data);
 int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data);
@@ -63,6 +117,158 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	enum ipc_command_type payload_type);
 bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
 	const char *payload, uint32_t payload_length);
+static bool ipc_send_reply_json(struct ipc_client *client,
+	enum ipc_command_type payload_type, json_object *json);
+static bool ipc_send_reply_encoded(struct ipc_client *client,
+	enum ipc_command_type payload_type, const void *payload,
+	uint32_t payload_length);
+
+static struct ipc_segment *ipc_segment_create(enum ipc_command_type payload_type,
+		const char *payload, uint32_t payload_length, bool copy) {
+	size_t size = sizeof(struct ipc_segment);
+	if (copy) {
+		size += payload_length;
+	}
+	struct ipc_segment *segment = malloc(size);
+	if (!segment) {
+		sway_log(SWAY_ERROR, "Unable to allocate ipc message");
+		return NULL;
+	}
+	segment->refs = 1;
+	memcpy(segment->header, ipc_magic, sizeof(ipc_magic));
+	memcpy(segment->header + sizeof(ipc_magic), &payload_length,
+		sizeof(payload_length));
+	memcpy(segment->header + sizeof(ipc_magic) + sizeof(payload_length),
+		&payload_type, sizeof(payload_type));
+	segment->json = NULL;
+	segment->cbor = NULL;
+	segment->payload_length = payload_length;
+	if (copy) {
+		memcpy(segment->data, payload, payload_length);
+		segment->payload = segment->data;
+	} else {
+		segment->payload = payload;
+	}
+	return segment;
+}
+
+/**
+ * Creates a segment which takes over the reference to the json object and
+ * points to its serialized string instead of copying it.
+ */
+static struct ipc_segment *ipc_segment_create_json(
+		enum ipc_command_type payload_type, json_object *json) {
+	size_t length;
+	const char *json_string = json_object_to_json_string_length(json,
+		JSON_C_TO_STRING_SPACED, &length);
+	struct ipc_segment *segment = ipc_segment_create(payload_type,
+		json_string, (uint32_t)length, false);
+	if (!segment) {
+		json_object_put(json);
+		return NULL;
+	}
+	segment->json = json;
+	return segment;
+}
+
+/**
+ * Creates a segment holding the json object encoded as CBOR. Takes over the
+ * reference to the json object.
+ *
+ * CBOR only changes how a payload is sent: it is built as json-c objects
+ * like for JSON clients, so sway does the same work for both encodings
+ * except for get_tree, which has its own cache (see ipc_json_get_tree_cbor).
+ */
+static struct ipc_segment *ipc_segment_create_cbor(
+		enum ipc_command_type payload_type, json_object *json) {
+	struct cbor_writer writer = {0};
+	cbor_write_json(&writer, json);
+	json_object_put(json);
+	if (writer.failed) {
+		free(writer.data);
+		return NULL;
+	}
+	struct ipc_segment *segment = ipc_segment_create(payload_type,
+		(const char *)writer.data, (uint32_t)writer.len, false);
+	if (!segment) {
+		free(writer.data);
+		return NULL;
+	}
+	segment->cbor = writer.data;
+	return segment;
+}
+
+static struct ipc_segment *ipc_segment_create_encoded(
+		enum ipc_encoding encoding, enum ipc_command_type payload_type,
+		json_object *json) {
+	switch (encoding) {
+	case IPC_ENCODING_CBOR:
+		return ipc_segment_create_cbor(payload_type, json);
+	case IPC_ENCODING_JSON:
+	case IPC_ENCODING_COUNT:
+		break;
+	}
+	return ipc_segment_create_json(payload_type, json);
+}
+
+static void ipc_segment_unref(struct ipc_segment *segment) {
+	if (--segment->refs > 0) {
+		return;
+	}
+	if (segment->json) {
+		json_object_put(segment->json);
+	}
+	free(segment->cbor);
+	free(segment);
+}
+
+static size_t ipc_segment_size(struct ipc_segment *segment) {
+	return IPC_HEADER_SIZE + segment->payload_length;
+}
+
+static struct ipc_segment *ipc_write_queue_get(struct ipc_write_queue *queue,
+		size_t i) {
+	return queue->segments[(queue->head + i) % queue->cap];
+}
+
+static bool ipc_write_queue_push(struct ipc_write_queue *queue,
+		struct ipc_segment *segment) {
+	if (queue->len == queue->cap) {
+		size_t cap = queue->cap ? queue->cap * 2 : 8;
+		struct ipc_segment **segments = calloc(cap, sizeof(*segments));
+		if (!segments) {
+			return false;
+		}
+		for (size_t i = 0; i < queue->len; i++) {
+			segments[i] = ipc_write_queue_get(queue, i);
+		}
+		free(queue->segments);
+		queue->segments = segments;
+		queue->head = 0;
+		queue->cap = cap;
+	}
+	segment->refs++;
+	queue->segments[(queue->head + queue->len) % queue->cap] = segment;
+	queue->len++;
+	queue->bytes += ipc_segment_size(segment);
+	return true;
+}
+
+static void ipc_write_queue_pop(struct ipc_write_queue *queue) {
+	struct ipc_segment *segment = queue->segments[queue->head];
+	queue->bytes -= ipc_segment_size(segment) - queue->offset;
+	queue->offset = 0;
+	queue->head = (queue->head + 1) % queue->cap;
+	queue->len--;
+	ipc_segment_unref(segment);
+}
+
+static void ipc_write_queue_finish(struct ipc_write_queue *queue) {
+	while (queue->len > 0) {
+		ipc_write_queue_pop(queue);
+	}
+	free(queue->segments);
+}
 
 static void handle_display_destroy(struct wl_listener *listener, void *data) {
 	if (ipc_event_source) {
@@ -180,18 +386,12 @@ int ipc_handle_connection(int fd, uint32_t mask, void *data) {
 	client->pending_length = 0;
 	client->fd = client_fd;
 	client->subscribed_events = 0;
+	client->encoding = IPC_ENCODING_JSON;
 	client->event_source = wl_event_loop_add_fd(server->wl_event_loop,
 			client_fd, WL_EVENT_READABLE, ipc_client_handle_readable, client);
 	client->writable_event_source = NULL;
-
-	client->write_buffer_size = 128;
-	client->write_buffer_len = 0;
-	client->write_buffer = malloc(client->write_buffer_size);
-	if (!client->write_buffer) {
-		sway_log(SWAY_ERROR, "Unable to allocate ipc client write buffer");
-		close(client_fd);
-		return 0;
-	}
+	client->queue = (struct ipc_write_queue){0};
+	client->stats = (struct ipc_client_stats){0};
 
 	sway_log(SWAY_DEBUG, "New client: fd %d", client_fd);
 	list_add(ipc_client_list, client);
@@ -274,26 +474,55 @@ static bool ipc_has_event_listeners(enum ipc_command_type event) {
 	return false;
 }
 
-static void ipc_send_event(const char *json_string, enum ipc_command_type event) {
+static bool ipc_client_queue(struct ipc_client *client,
+		struct ipc_segment *segment);
+
+/**
+ * Serializes the event once per encoding in use and queues it for all
+ * subscribed clients. Takes over the reference to the json object.
+ */
+static void ipc_send_event(json_object *json, enum ipc_command_type event) {
+	struct ipc_segment *segments[IPC_ENCODING_COUNT] = {0};
+
 	struct ipc_client *client;
 	for (int i = 0; i < ipc_client_list->length; i++) {
 		client = ipc_client_list->items[i];
 		if ((client->subscribed_events & event_mask(event)) == 0) {
 			continue;
 		}
-		if (!ipc_send_reply(client, event, json_string,
-				(uint32_t)strlen(json_string))) {
+		struct ipc_segment **segment = &segments[client->encoding];
+		if (!*segment) {
+			*segment = ipc_segment_create_encoded(client->encoding, event,
+				json_object_get(json));
+			if (!*segment) {
+				continue;
+			}
+		}
+		if (!ipc_client_queue(client, *segment)) {
 			sway_log_errno(SWAY_INFO, "Unable to send reply to IPC client");
-			/* ipc_send_reply destroys client on error, which also
+			/* ipc_client_queue destroys client on error, which also
 			 * removes it from the list, so we need to process
 			 * current index again */
 			i--;
 		}
 	}
+	for (size_t i = 0; i < IPC_ENCODING_COUNT; i++) {
+		if (segments[i]) {
+			ipc_segment_unref(segments[i]);
+		}
+	}
+	json_object_put(json);
 }
 
 void ipc_event_workspace(struct sway_workspace *old,
 		struct sway_workspace *new, const char *change) {
+	// Visibility changes are handled with the focus, see seat_set_raw_focus
+	if (old) {
+		ipc_json_invalidate_node(&old->node);
+	}
+	if (new) {
+		ipc_json_invalidate_node(&new->node);
+	}
 	if (!ipc_has_event_listeners(IPC_EVENT_WORKSPACE)) {
 		return;
 	}
@@ -314,12 +543,26 @@ void ipc_event_workspace(struct sway_workspace *old,
 		json_object_object_add(obj, "current", NULL);
 	}
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WORKSPACE);
-	json_object_put(obj);
+	ipc_send_event(obj, IPC_EVENT_WORKSPACE);
 }
 
 void ipc_event_window(struct sway_container *window, const char *change) {
+	if (strcmp(change, "title") == 0 || strcmp(change, "mark") == 0 ||
+			strcmp(change, "urgent") == 0) {
+		ipc_json_invalidate_node(&window->node);
+		// These don't go through a transaction, so patch them here
+		json_object *changes = ipc_event_tree_patch_begin();
+		if (changes) {
+			ipc_json_describe_property_patch(changes, &window->node);
+			ipc_event_tree_patch(changes);
+		}
+	} else if (strcmp(change, "fullscreen_mode") == 0) {
+		// Fullscreen hides or reveals other views, on every output when it
+		// is global, and the previous mode is no longer known here
+		ipc_json_invalidate_subtree(&root->node);
+	} else {
+		ipc_json_invalidate_node(&window->node);
+	}
 	if (!ipc_has_event_listeners(IPC_EVENT_WINDOW)) {
 		return;
 	}
@@ -329,9 +572,34 @@ void ipc_event_window(struct sway_container *window, const char *change) {
 	json_object_object_add(obj, "container",
 			ipc_json_describe_node_recursive(&window->node));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_WINDOW);
-	json_object_put(obj);
+	ipc_send_event(obj, IPC_EVENT_WINDOW);
+}
+
+bool ipc_event_tree_patch_wanted(void) {
+	return ipc_has_event_listeners(IPC_EVENT_TREE_PATCH);
+}
+
+json_object *ipc_event_tree_patch_begin(void) {
+	if (!ipc_has_event_listeners(IPC_EVENT_TREE_PATCH)) {
+		return NULL;
+	}
+	return json_object_new_array();
+}
+
+void ipc_event_tree_patch(json_object *changes) {
+	if (json_object_array_length(changes) == 0 ||
+			!ipc_has_event_listeners(IPC_EVENT_TREE_PATCH)) {
+		json_object_put(changes);
+		return;
+	}
+	sway_log(SWAY_DEBUG, "Sending tree_patch event");
+
+	json_object *json = json_object_new_object();
+	json_object_object_add(json, "serial",
+			json_object_new_int64(++tree_patch_serial));
+	json_object_object_add(json, "changes", changes);
+
+	ipc_send_event(json, IPC_EVENT_TREE_PATCH);
 }
 
 void ipc_event_barconfig_update(struct bar_config *bar) {
@@ -341,9 +609,7 @@ void ipc_event_barconfig_update(struct bar_config *bar) {
 	sway_log(SWAY_DEBUG, "Sending barconfig_update event");
 	json_object *json = ipc_json_describe_bar_config(bar);
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BARCONFIG_UPDATE);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_BARCONFIG_UPDATE);
 }
 
 void ipc_event_bar_state_update(struct bar_config *bar) {
@@ -357,9 +623,7 @@ void ipc_event_bar_state_update(struct bar_config *bar) {
 	json_object_object_add(json, "visible_by_modifier",
 			json_object_new_boolean(bar->visible_by_modifier));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BAR_STATE_UPDATE);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_BAR_STATE_UPDATE);
 }
 
 void ipc_event_mode(const char *mode, bool pango) {
@@ -372,9 +636,7 @@ void ipc_event_mode(const char *mode, bool pango) {
 	json_object_object_add(obj, "pango_markup",
 			json_object_new_boolean(pango));
 
-	const char *json_string = json_object_to_json_string(obj);
-	ipc_send_event(json_string, IPC_EVENT_MODE);
-	json_object_put(obj);
+	ipc_send_event(obj, IPC_EVENT_MODE);
 }
 
 void ipc_event_shutdown(const char *reason) {
@@ -386,9 +648,7 @@ void ipc_event_shutdown(const char *reason) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string(reason));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_SHUTDOWN);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_SHUTDOWN);
 }
 
 void ipc_event_binding(struct sway_binding *binding) {
@@ -472,9 +732,7 @@ void ipc_event_binding(struct sway_binding *binding) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string("run"));
 	json_object_object_add(json, "binding", json_binding);
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_BINDING);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_BINDING);
 }
 
 static void ipc_event_tick(const char *payload) {
@@ -487,9 +745,7 @@ static void ipc_event_tick(const char *payload) {
 	json_object_object_add(json, "first", json_object_new_boolean(false));
 	json_object_object_add(json, "payload", json_object_new_string(payload));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_TICK);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_TICK);
 }
 
 void ipc_event_input(const char *change, struct sway_input_device *device) {
@@ -502,12 +758,14 @@ void ipc_event_input(const char *change, struct sway_input_device *device) {
 	json_object_object_add(json, "change", json_object_new_string(change));
 	json_object_object_add(json, "input", ipc_json_describe_input(device));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_INPUT);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_INPUT);
 }
 
 void ipc_event_output(void) {
+	for (int i = 0; i < root->outputs->length; ++i) {
+		struct sway_output *output = root->outputs->items[i];
+		ipc_json_invalidate_node(&output->node);
+	}
 	if (!ipc_has_event_listeners(IPC_EVENT_OUTPUT)) {
 		return;
 	}
@@ -516,9 +774,17 @@ void ipc_event_output(void) {
 	json_object *json = json_object_new_object();
 	json_object_object_add(json, "change", json_object_new_string("unspecified"));
 
-	const char *json_string = json_object_to_json_string(json);
-	ipc_send_event(json_string, IPC_EVENT_OUTPUT);
-	json_object_put(json);
+	ipc_send_event(json, IPC_EVENT_OUTPUT);
+}
+
+void ipc_event_output_stats(struct sway_output *output) {
+	if (!ipc_has_event_listeners(IPC_EVENT_OUTPUT_STATS)) {
+		return;
+	}
+	sway_log(SWAY_DEBUG, "Sending output_stats event");
+
+	ipc_send_event(ipc_json_describe_output_stats(output),
+			IPC_EVENT_OUTPUT_STATS);
 }
 
 int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
@@ -535,11 +801,35 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	if (client->write_buffer_len <= 0) {
+	struct ipc_write_queue *queue = &client->queue;
+	if (queue->len == 0) {
 		return 0;
 	}
 
-	ssize_t written = write(client->fd, client->write_buffer, client->write_buffer_len);
+	struct iovec iov[IPC_WRITE_BATCH * 2];
+	int iovcnt = 0;
+	size_t skip = queue->offset;
+	for (size_t i = 0; i < queue->len && i < IPC_WRITE_BATCH; i++) {
+		struct ipc_segment *segment = ipc_write_queue_get(queue, i);
+		if (skip < IPC_HEADER_SIZE) {
+			iov[iovcnt++] = (struct iovec){
+				.iov_base = segment->header + skip,
+				.iov_len = IPC_HEADER_SIZE - skip,
+			};
+			skip = 0;
+		} else {
+			skip -= IPC_HEADER_SIZE;
+		}
+		if (segment->payload_length > skip) {
+			iov[iovcnt++] = (struct iovec){
+				.iov_base = (char *)segment->payload + skip,
+				.iov_len = segment->payload_length - skip,
+			};
+		}
+		skip = 0;
+	}
+
+	ssize_t written = writev(client->fd, iov, iovcnt);
 
 	if (written == -1 && errno == EAGAIN) {
 		return 0;
@@ -549,10 +839,24 @@ int ipc_client_handle_writable(int client_fd, uint32_t mask, void *data) {
 		return 0;
 	}
 
-	memmove(client->write_buffer, client->write_buffer + written, client->write_buffer_len - written);
-	client->write_buffer_len -= written;
+	client->stats.writes++;
+	client->stats.bytes_written += written;
 
-	if (client->write_buffer_len == 0 && client->writable_event_source) {
+	size_t remaining = written;
+	while (queue->len > 0) {
+		struct ipc_segment *segment = ipc_write_queue_get(queue, 0);
+		size_t left = ipc_segment_size(segment) - queue->offset;
+		if (remaining < left) {
+			queue->offset += remaining;
+			queue->bytes -= remaining;
+			client->stats.partial_writes++;
+			break;
+		}
+		remaining -= left;
+		ipc_write_queue_pop(queue);
+	}
+
+	if (queue->len == 0 && client->writable_event_source) {
 		wl_event_source_remove(client->writable_event_source);
 		client->writable_event_source = NULL;
 	}
@@ -577,7 +881,7 @@ void ipc_client_disconnect(struct ipc_client *client) {
 		i++;
 	}
 	list_del(ipc_client_list, i);
-	free(client->write_buffer);
+	ipc_write_queue_finish(&client->queue);
 	close(client->fd);
 	free(client);
 }
@@ -601,6 +905,40 @@ static void ipc_get_workspaces_callback(struct sway_workspace *workspace,
 			json_object_new_boolean(visible));
 }
 
+static json_object *ipc_describe_clients(void) {
+	json_object *clients = json_object_new_array();
+	for (int i = 0; i < ipc_client_list->length; i++) {
+		struct ipc_client *client = ipc_client_list->items[i];
+		json_object *object = json_object_new_object();
+		json_object_object_add(object, "fd", json_object_new_int(client->fd));
+		json_object_object_add(object, "encoding",
+				json_object_new_string(ipc_encoding_names[client->encoding]));
+		json_object_object_add(object, "queued_bytes",
+				json_object_new_int64(client->queue.bytes));
+		json_object_object_add(object, "queued_messages",
+				json_object_new_int64(client->queue.len));
+		json_object_object_add(object, "max_queued_bytes",
+				json_object_new_int64(client->stats.max_queued_bytes));
+		json_object_object_add(object, "messages_queued",
+				json_object_new_int64(client->stats.messages_queued));
+		json_object_object_add(object, "bytes_written",
+				json_object_new_int64(client->stats.bytes_written));
+		json_object_object_add(object, "writes",
+				json_object_new_int64(client->stats.writes));
+		json_object_object_add(object, "partial_writes",
+				json_object_new_int64(client->stats.partial_writes));
+		json_object_array_add(clients, object);
+	}
+
+	json_object *ipc = json_object_new_object();
+	json_object_object_add(ipc, "queue_limit",
+			json_object_new_int64(IPC_CLIENT_MAX_QUEUED));
+	json_object_object_add(ipc, "clients_dropped",
+			json_object_new_int64(ipc_clients_dropped));
+	json_object_object_add(ipc, "clients", clients);
+	return ipc;
+}
+
 static void ipc_get_marks_callback(struct sway_container *con, void *data) {
 	json_object *marks = (json_object *)data;
 	for (int i = 0; i < con->marks->length; ++i) {
@@ -709,10 +1047,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			json_object_array_add(outputs, ipc_json_describe_non_desktop_output(non_desktop_output));
 		}
 
-		const char *json_string = json_object_to_json_string(outputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(outputs); // free
+		ipc_send_reply_json(client, payload_type, outputs);
 		goto exit_cleanup;
 	}
 
@@ -720,10 +1055,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *workspaces = json_object_new_array();
 		root_for_each_workspace(ipc_get_workspaces_callback, workspaces);
-		const char *json_string = json_object_to_json_string(workspaces);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(workspaces); // free
+		ipc_send_reply_json(client, payload_type, workspaces);
 		goto exit_cleanup;
 	}
 
@@ -763,6 +1095,10 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				is_tick = true;
 			} else if (strcmp(event_type, "input") == 0) {
 				client->subscribed_events |= event_mask(IPC_EVENT_INPUT);
+			} else if (strcmp(event_type, "tree_patch") == 0) {
+				client->subscribed_events |= event_mask(IPC_EVENT_TREE_PATCH);
+			} else if (strcmp(event_type, "output_stats") == 0) {
+				client->subscribed_events |= event_mask(IPC_EVENT_OUTPUT_STATS);
 			} else {
 				const char msg[] = "{\"success\": false}";
 				ipc_send_reply(client, payload_type, msg, strlen(msg));
@@ -790,10 +1126,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(device, &server.input->devices, link) {
 			json_object_array_add(inputs, ipc_json_describe_input(device));
 		}
-		const char *json_string = json_object_to_json_string(inputs);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(inputs); // free
+		ipc_send_reply_json(client, payload_type, inputs);
 		goto exit_cleanup;
 	}
 
@@ -804,20 +1137,60 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 		wl_list_for_each(seat, &server.input->seats, link) {
 			json_object_array_add(seats, ipc_json_describe_seat(seat));
 		}
-		const char *json_string = json_object_to_json_string(seats);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(seats); // free
+		ipc_send_reply_json(client, payload_type, seats);
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_STATS:
+	{
+		json_object *stats = ipc_json_get_stats();
+		json_object_object_add(stats, "ipc", ipc_describe_clients());
+		ipc_send_reply_json(client, payload_type, stats);
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_OUTPUT_STATS:
+	{
+		json_object *outputs = json_object_new_array();
+		for (int i = 0; i < root->outputs->length; ++i) {
+			struct sway_output *output = root->outputs->items[i];
+			json_object_array_add(outputs,
+					ipc_json_describe_output_stats(output));
+		}
+		ipc_send_reply_json(client, payload_type, outputs);
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_TRANSACTION_STATS:
+	{
+		json_object *stats = ipc_json_get_transaction_stats();
+		ipc_send_reply_json(client, payload_type, stats);
 		goto exit_cleanup;
 	}
 
 	case IPC_GET_TREE:
 	{
-		json_object *tree = ipc_json_describe_node_recursive(&root->node);
-		const char *json_string = json_object_to_json_string(tree);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(tree);
+		size_t length;
+		const void *tree = client->encoding == IPC_ENCODING_CBOR ?
+			(const void *)ipc_json_get_tree_cbor(&length) :
+			(const void *)ipc_json_get_tree(&length);
+		if (tree) {
+			ipc_send_reply_encoded(client, payload_type, tree, (uint32_t)length);
+		} else {
+			ipc_send_reply_json(client, payload_type,
+					ipc_json_describe_node_recursive(&root->node));
+		}
+		goto exit_cleanup;
+	}
+
+	case IPC_GET_TREE_SNAPSHOT:
+	{
+		json_object *snapshot = json_object_new_object();
+		json_object_object_add(snapshot, "serial",
+				json_object_new_int64(tree_patch_serial));
+		json_object_object_add(snapshot, "tree",
+				ipc_json_describe_node_recursive(&root->node));
+		ipc_send_reply_json(client, payload_type, snapshot);
 		goto exit_cleanup;
 	}
 
@@ -825,20 +1198,20 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *marks = json_object_new_array();
 		root_for_each_container(ipc_get_marks_callback, marks);
-		const char *json_string = json_object_to_json_string(marks);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(marks);
+		ipc_send_reply_json(client, payload_type, marks);
 		goto exit_cleanup;
 	}
 
 	case IPC_GET_VERSION:
 	{
 		json_object *version = ipc_json_get_version();
-		const char *json_string = json_object_to_json_string(version);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(version); // free
+		json_object *encodings = json_object_new_array();
+		for (size_t i = 0; i < IPC_ENCODING_COUNT; i++) {
+			json_object_array_add(encodings,
+					json_object_new_string(ipc_encoding_names[i]));
+		}
+		json_object_object_add(version, "encodings", encodings);
+		ipc_send_reply_json(client, payload_type, version);
 		goto exit_cleanup;
 	}
 
@@ -851,10 +1224,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				struct bar_config *bar = config->bars->items[i];
 				json_object_array_add(bars, json_object_new_string(bar->id));
 			}
-			const char *json_string = json_object_to_json_string(bars);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
-			json_object_put(bars); // free
+			ipc_send_reply_json(client, payload_type, bars);
 		} else {
 			// Send particular bar's details
 			struct bar_config *bar = NULL;
@@ -872,10 +1242,7 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 				goto exit_cleanup;
 			}
 			json_object *json = ipc_json_describe_bar_config(bar);
-			const char *json_string = json_object_to_json_string(json);
-			ipc_send_reply(client, payload_type, json_string,
-				(uint32_t)strlen(json_string));
-			json_object_put(json); // free
+			ipc_send_reply_json(client, payload_type, json);
 		}
 		goto exit_cleanup;
 	}
@@ -887,20 +1254,14 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 			struct sway_mode *mode = config->modes->items[i];
 			json_object_array_add(modes, json_object_new_string(mode->name));
 		}
-		const char *json_string = json_object_to_json_string(modes);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(modes); // free
+		ipc_send_reply_json(client, payload_type, modes);
 		goto exit_cleanup;
 	}
 
 	case IPC_GET_BINDING_STATE:
 	{
 		json_object *current_mode = ipc_json_get_binding_mode();
-		const char *json_string = json_object_to_json_string(current_mode);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(current_mode); // free
+		ipc_send_reply_json(client, payload_type, current_mode);
 		goto exit_cleanup;
 	}
 
@@ -908,10 +1269,23 @@ void ipc_client_handle_command(struct ipc_client *client, uint32_t payload_lengt
 	{
 		json_object *json = json_object_new_object();
 		json_object_object_add(json, "config", json_object_new_string(config->current_config));
-		const char *json_string = json_object_to_json_string(json);
-		ipc_send_reply(client, payload_type, json_string,
-			(uint32_t)strlen(json_string));
-		json_object_put(json); // free
+		ipc_send_reply_json(client, payload_type, json);
+		goto exit_cleanup;
+	}
+
+	case IPC_SET_ENCODING:
+	{
+		// The reply is sent in the encoding in use before the request
+		for (size_t i = 0; i < IPC_ENCODING_COUNT; i++) {
+			if (strcmp(buf, ipc_encoding_names[i]) == 0) {
+				const char msg[] = "{\"success\": true}";
+				ipc_send_reply(client, payload_type, msg, strlen(msg));
+				client->encoding = i;
+				goto exit_cleanup;
+			}
+		}
+		const char msg[] = "{\"success\": false}";
+		ipc_send_reply(client, payload_type, msg, strlen(msg));
 		goto exit_cleanup;
 	}
 
@@ -932,40 +1306,26 @@ exit_cleanup:
 	free(buf);
 }
 
-bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
-		const char *payload, uint32_t payload_length) {
-	assert(payload);
-
-	char data[IPC_HEADER_SIZE];
-
-	memcpy(data, ipc_magic, sizeof(ipc_magic));
-	memcpy(data + sizeof(ipc_magic), &payload_length, sizeof(payload_length));
-	memcpy(data + sizeof(ipc_magic) + sizeof(payload_length), &payload_type, sizeof(payload_type));
-
-	while (client->write_buffer_len + IPC_HEADER_SIZE + payload_length >=
-				 client->write_buffer_size) {
-		client->write_buffer_size *= 2;
-	}
-
-	if (client->write_buffer_size > 4e6) { // 4 MB
-		sway_log(SWAY_ERROR, "Client write buffer too big (%zu), disconnecting client",
-				client->write_buffer_size);
+static bool ipc_client_queue(struct ipc_client *client,
+		struct ipc_segment *segment) {
+	size_t size = ipc_segment_size(segment);
+	if (client->queue.bytes + size > IPC_CLIENT_MAX_QUEUED) {
+		sway_log(SWAY_ERROR, "Client write queue too big (%zu), disconnecting client",
+				client->queue.bytes + size);
+		ipc_clients_dropped++;
 		ipc_client_disconnect(client);
 		return false;
 	}
 
-	char *new_buffer = realloc(client->write_buffer, client->write_buffer_size);
-	if (!new_buffer) {
-		sway_log(SWAY_ERROR, "Unable to reallocate ipc client write buffer");
+	if (!ipc_write_queue_push(&client->queue, segment)) {
+		sway_log(SWAY_ERROR, "Unable to grow ipc client write queue");
 		ipc_client_disconnect(client);
 		return false;
 	}
-	client->write_buffer = new_buffer;
-
-	memcpy(client->write_buffer + client->write_buffer_len, data, IPC_HEADER_SIZE);
-	client->write_buffer_len += IPC_HEADER_SIZE;
-	memcpy(client->write_buffer + client->write_buffer_len, payload, payload_length);
-	client->write_buffer_len += payload_length;
+	client->stats.messages_queued++;
+	if (client->queue.bytes > client->stats.max_queued_bytes) {
+		client->stats.max_queued_bytes = client->queue.bytes;
+	}
 
 	if (!client->writable_event_source) {
 		client->writable_event_source = wl_event_loop_add_fd(
@@ -975,3 +1335,58 @@ bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_typ
 
 	return true;
 }
+
+bool ipc_send_reply(struct ipc_client *client, enum ipc_command_type payload_type,
+		const char *payload, uint32_t payload_length) {
+	assert(payload);
+
+	if (client->encoding != IPC_ENCODING_JSON) {
+		// Replies which are already serialized are rare and small, so just
+		// parse them back for the other encodings
+		json_tokener *tok = json_tokener_new();
+		json_object *json = tok ?
+			json_tokener_parse_ex(tok, payload, payload_length) : NULL;
+		json_tokener_free(tok);
+		if (!json) {
+			sway_log(SWAY_ERROR, "Unable to re-encode IPC reply");
+			ipc_client_disconnect(client);
+			return false;
+		}
+		return ipc_send_reply_json(client, payload_type, json);
+	}
+	return ipc_send_reply_encoded(client, payload_type, payload, payload_length);
+}
+
+/**
+ * Sends a copy of a payload which is already in the client's encoding.
+ */
+static bool ipc_send_reply_encoded(struct ipc_client *client,
+		enum ipc_command_type payload_type, const void *payload,
+		uint32_t payload_length) {
+	struct ipc_segment *segment = ipc_segment_create(payload_type,
+		payload, payload_length, true);
+	if (!segment) {
+		ipc_client_disconnect(client);
+		return false;
+	}
+	bool success = ipc_client_queue(client, segment);
+	ipc_segment_unref(segment);
+	return success;
+}
+
+/**
+ * Sends the serialized json object without copying it. Takes over the
+ * reference to the object.
+ */
+static bool ipc_send_reply_json(struct ipc_client *client,
+		enum ipc_command_type payload_type, json_object *json) {
+	struct ipc_segment *segment = ipc_segment_create_encoded(client->encoding,
+		payload_type, json);
+	if (!segment) {
+		ipc_client_disconnect(client);
+		return false;
+	}
+	bool success = ipc_client_queue(client, segment);
+	ipc_segment_unref(segment);
+	return success;
+}
@@ -173,6 +173,12 @@ void enable_debug_flag(const char *flag) {
 		debug.txn_wait = true;
 	} else if (strcmp(flag, "txn-timings") == 0) {
 		debug.txn_timings = true;
+	} else if (strcmp(flag, "scene-check") == 0) {
+		debug.scene_check = true;
+	} else if (strcmp(flag, "txn-coalesce") == 0) {
+		debug.txn_coalesce = true;
+	} else if (strcmp(flag, "focus-check") == 0) {
+		debug.focus_check = true;
 	} else if (has_prefix(flag, "txn-timeout=")) {
 		server.txn_timeout_ms = atoi(&flag[strlen("txn-timeout=")]);
 	} else {
@@ -476,6 +476,7 @@ bool server_init(struct sway_server *server) {
 		server->wl_display, 1, server->renderer);
 
 	wl_list_init(&server->pending_launcher_ctxs);
+	wl_list_init(&server->transaction_clients);
 
 	// Avoid using "wayland-0" as display socket
 	char name_candidate[16];
@@ -544,6 +545,9 @@ void server_fini(struct sway_server *server) {
 	wl_list_remove(&server->request_set_cursor_shape.link);
 	wl_list_remove(&server->new_foreign_toplevel_capture_request.link);
 	input_manager_finish(server->input);
+	if (server->txn_commit_timer) {
+		wl_event_source_remove(server->txn_commit_timer);
+	}
 
 	// TODO: free sway-specific resources
 #if WLR_HAS_XWAYLAND
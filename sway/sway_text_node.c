@@ -43,10 +43,182 @@ static const struct wlr_buffer_impl cairo_buffer_impl = {
 	.end_data_ptr_access = cairo_buffer_handle_end_data_ptr_access,
 };
 
+#define TEXT_CACHE_BUCKETS 256
+// Upper bound for the memory held by cache entries that no text node uses
+// anymore. Entries still in use are never evicted.
+#define TEXT_CACHE_BUDGET (16 * 1024 * 1024)
+
+/**
+ * Everything that affects the pixels of a rendered text buffer. Two text
+ * nodes with equal keys can share the same wlr_buffer.
+ */
+struct text_cache_key {
+	const char *text;
+	const char *font;
+	bool pango_markup;
+	float color[4];
+	float background[4];
+	float scale;
+	enum wl_output_subpixel subpixel;
+	int width, height;
+	int baseline_offset;
+};
+
+struct text_cache_entry {
+	struct wl_list link; // text_cache.buckets[]
+	struct wl_list lru_link; // text_cache.lru, only while unused
+	uint32_t hash;
+	struct text_cache_key key;
+	struct cairo_buffer *buffer;
+	size_t size;
+	int users;
+};
+
+static struct {
+	bool initialized;
+	struct wl_list buckets[TEXT_CACHE_BUCKETS];
+	struct wl_list lru; // most recently released first
+	struct sway_text_cache_stats stats;
+} text_cache;
+
+static void text_cache_init(void) {
+	if (text_cache.initialized) {
+		return;
+	}
+	for (size_t i = 0; i < TEXT_CACHE_BUCKETS; i++) {
+		wl_list_init(&text_cache.buckets[i]);
+	}
+	wl_list_init(&text_cache.lru);
+	text_cache.initialized = true;
+}
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len) {
+	// FNV-1a
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static uint32_t text_cache_key_hash(const struct text_cache_key *key) {
+	uint32_t hash = 2166136261;
+	hash = hash_bytes(hash, key->text, strlen(key->text));
+	hash = hash_bytes(hash, key->font, strlen(key->font));
+	hash = hash_bytes(hash, &key->pango_markup, sizeof(key->pango_markup));
+	hash = hash_bytes(hash, key->color, sizeof(key->color));
+	hash = hash_bytes(hash, key->background, sizeof(key->background));
+	hash = hash_bytes(hash, &key->scale, sizeof(key->scale));
+	hash = hash_bytes(hash, &key->subpixel, sizeof(key->subpixel));
+	hash = hash_bytes(hash, &key->width, sizeof(key->width));
+	hash = hash_bytes(hash, &key->height, sizeof(key->height));
+	hash = hash_bytes(hash, &key->baseline_offset, sizeof(key->baseline_offset));
+	return hash;
+}
+
+static bool text_cache_key_equal(const struct text_cache_key *a,
+		const struct text_cache_key *b) {
+	return a->pango_markup == b->pango_markup &&
+		memcmp(a->color, b->color, sizeof(a->color)) == 0 &&
+		memcmp(a->background, b->background, sizeof(a->background)) == 0 &&
+		a->scale == b->scale &&
+		a->subpixel == b->subpixel &&
+		a->width == b->width &&
+		a->height == b->height &&
+		a->baseline_offset == b->baseline_offset &&
+		strcmp(a->text, b->text) == 0 &&
+		strcmp(a->font, b->font) == 0;
+}
+
+static struct text_cache_entry *text_cache_lookup(
+		const struct text_cache_key *key, uint32_t hash) {
+	struct wl_list *bucket = &text_cache.buckets[hash % TEXT_CACHE_BUCKETS];
+	struct text_cache_entry *entry;
+	wl_list_for_each(entry, bucket, link) {
+		if (entry->hash == hash && text_cache_key_equal(&entry->key, key)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void text_cache_entry_destroy(struct text_cache_entry *entry) {
+	wl_list_remove(&entry->link);
+	wl_list_remove(&entry->lru_link);
+	text_cache.stats.entries--;
+	text_cache.stats.bytes -= entry->size;
+
+	// The buffer stays alive as long as a scene buffer still holds a lock
+	wlr_buffer_drop(&entry->buffer->base);
+	free((char *)entry->key.text);
+	free((char *)entry->key.font);
+	free(entry);
+}
+
+static void text_cache_trim(void) {
+	while (text_cache.stats.bytes > TEXT_CACHE_BUDGET &&
+			!wl_list_empty(&text_cache.lru)) {
+		struct text_cache_entry *entry =
+			wl_container_of(text_cache.lru.prev, entry, lru_link);
+		text_cache_entry_destroy(entry);
+		text_cache.stats.evictions++;
+	}
+}
+
+static void text_cache_entry_ref(struct text_cache_entry *entry) {
+	if (entry->users++ == 0) {
+		wl_list_remove(&entry->lru_link);
+		wl_list_init(&entry->lru_link);
+	}
+}
+
+static void text_cache_entry_unref(struct text_cache_entry *entry) {
+	if (!entry || --entry->users > 0) {
+		return;
+	}
+	wl_list_remove(&entry->lru_link);
+	wl_list_insert(&text_cache.lru, &entry->lru_link);
+	text_cache_trim();
+}
+
+static struct text_cache_entry *text_cache_insert(
+		const struct text_cache_key *key, uint32_t hash,
+		struct cairo_buffer *buffer) {
+	struct text_cache_entry *entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		return NULL;
+	}
+	entry->key = *key;
+	entry->key.text = strdup(key->text);
+	entry->key.font = strdup(key->font);
+	if (!entry->key.text || !entry->key.font) {
+		free((char *)entry->key.text);
+		free((char *)entry->key.font);
+		free(entry);
+		return NULL;
+	}
+	entry->hash = hash;
+	entry->buffer = buffer;
+	entry->size = (size_t)cairo_image_surface_get_stride(buffer->surface) *
+		cairo_image_surface_get_height(buffer->surface);
+
+	wl_list_insert(&text_cache.buckets[hash % TEXT_CACHE_BUCKETS], &entry->link);
+	wl_list_init(&entry->lru_link);
+	text_cache.stats.entries++;
+	text_cache.stats.bytes += entry->size;
+	return entry;
+}
+
+void sway_text_node_get_cache_stats(struct sway_text_cache_stats *stats) {
+	*stats = text_cache.stats;
+}
+
 struct text_buffer {
 	struct wlr_scene_buffer *buffer_node;
 	char *text;
 	struct sway_text_node props;
+	struct text_cache_entry *cached;
 
 	bool visible;
 	float scale;
@@ -64,26 +236,16 @@ static int get_text_width(struct sway_text_node *props) {
 	return MAX(width, 0);
 }
 
-static void render_backing_buffer(struct text_buffer *buffer) {
-	if (!buffer->visible) {
-		return;
-	}
-
-	if (buffer->props.max_width == 0) {
-		wlr_scene_buffer_set_buffer(buffer->buffer_node, NULL);
-		return;
-	}
-
-	float scale = buffer->scale;
-	int width = ceil(get_text_width(&buffer->props) * scale);
-	int height = ceil(buffer->props.height * scale);
-	float *color = (float *)&buffer->props.color;
-	float *background = (float *)&buffer->props.background;
+static struct cairo_buffer *rasterize_text(const struct text_cache_key *key) {
+	float scale = key->scale;
+	const float *color = key->color;
+	const float *background = key->background;
+	struct cairo_buffer *cairo_buffer = NULL;
 	PangoContext *pango = NULL;
 
 	cairo_font_options_t *fo = cairo_font_options_create();
 	cairo_font_options_set_hint_style(fo, CAIRO_HINT_STYLE_FULL);
-	enum wl_output_subpixel subpixel = buffer->subpixel;
+	enum wl_output_subpixel subpixel = key->subpixel;
 	if (subpixel == WL_OUTPUT_SUBPIXEL_NONE || subpixel == WL_OUTPUT_SUBPIXEL_UNKNOWN) {
 		cairo_font_options_set_antialias(fo, CAIRO_ANTIALIAS_GRAY);
 	} else {
@@ -92,7 +254,7 @@ static void render_backing_buffer(struct text_buffer *buffer) {
 	}
 
 	cairo_surface_t *surface = cairo_image_surface_create(
-			CAIRO_FORMAT_ARGB32, width, height);
+			CAIRO_FORMAT_ARGB32, key->width, key->height);
 	cairo_status_t status = cairo_surface_status(surface);
 	if (status != CAIRO_STATUS_SUCCESS) {
 		sway_log(SWAY_ERROR, "cairo_image_surface_create failed: %s",
@@ -100,7 +262,7 @@ static void render_backing_buffer(struct text_buffer *buffer) {
 		goto err;
 	}
 
-	struct cairo_buffer *cairo_buffer = calloc(1, sizeof(*cairo_buffer));
+	cairo_buffer = calloc(1, sizeof(*cairo_buffer));
 	if (!cairo_buffer) {
 		sway_log(SWAY_ERROR, "cairo_buffer allocation failed");
 		goto err;
@@ -110,6 +272,7 @@ static void render_backing_buffer(struct text_buffer *buffer) {
 	if (!cairo) {
 		sway_log(SWAY_ERROR, "cairo_create failed");
 		free(cairo_buffer);
+		cairo_buffer = NULL;
 		goto err;
 	}
 
@@ -118,36 +281,95 @@ static void render_backing_buffer(struct text_buffer *buffer) {
 	pango = pango_cairo_create_context(cairo);
 
 	cairo_set_source_rgba(cairo, background[0], background[1], background[2], background[3]);
-	cairo_rectangle(cairo, 0, 0, width, height);
+	cairo_rectangle(cairo, 0, 0, key->width, key->height);
 	cairo_fill(cairo);
 
 	cairo_set_source_rgba(cairo, color[0], color[1], color[2], color[3]);
-	cairo_move_to(cairo, 0, (config->font_baseline - buffer->props.baseline) * scale);
+	cairo_move_to(cairo, 0, key->baseline_offset * scale);
 
-	render_text(cairo, config->font_description, scale, buffer->props.pango_markup,
-		"%s", buffer->text);
+	render_text(cairo, config->font_description, scale, key->pango_markup,
+		"%s", key->text);
 
 	cairo_surface_flush(surface);
 
-	wlr_buffer_init(&cairo_buffer->base, &cairo_buffer_impl, width, height);
+	wlr_buffer_init(&cairo_buffer->base, &cairo_buffer_impl, key->width, key->height);
 	cairo_buffer->surface = surface;
 	cairo_buffer->cairo = cairo;
+	surface = NULL;
+
+err:
+	if (surface) cairo_surface_destroy(surface);
+	if (pango) g_object_unref(pango);
+	cairo_font_options_destroy(fo);
+	return cairo_buffer;
+}
+
+static void text_buffer_set_cached(struct text_buffer *buffer,
+		struct text_cache_entry *entry) {
+	// Take the new reference before dropping the old one, they may be equal
+	if (entry) {
+		text_cache_entry_ref(entry);
+	}
+	wlr_scene_buffer_set_buffer(buffer->buffer_node,
+		entry ? &entry->buffer->base : NULL);
+	text_cache_entry_unref(buffer->cached);
+	buffer->cached = entry;
+}
 
-	wlr_scene_buffer_set_buffer(buffer->buffer_node, &cairo_buffer->base);
-	wlr_buffer_drop(&cairo_buffer->base);
+static void render_backing_buffer(struct text_buffer *buffer) {
+	if (!buffer->visible) {
+		return;
+	}
+
+	if (buffer->props.max_width == 0) {
+		text_buffer_set_cached(buffer, NULL);
+		return;
+	}
+
+	text_cache_init();
+
+	float scale = buffer->scale;
+	struct text_cache_key key = {
+		.text = buffer->text,
+		.font = config->font,
+		.pango_markup = buffer->props.pango_markup,
+		.scale = scale,
+		.subpixel = buffer->subpixel,
+		.width = ceil(get_text_width(&buffer->props) * scale),
+		.height = ceil(buffer->props.height * scale),
+		.baseline_offset = config->font_baseline - buffer->props.baseline,
+	};
+	memcpy(key.color, buffer->props.color, sizeof(key.color));
+	memcpy(key.background, buffer->props.background, sizeof(key.background));
+	uint32_t hash = text_cache_key_hash(&key);
+
+	struct text_cache_entry *entry = text_cache_lookup(&key, hash);
+	if (entry) {
+		text_cache.stats.hits++;
+	} else {
+		text_cache.stats.misses++;
+		struct cairo_buffer *cairo_buffer = rasterize_text(&key);
+		if (!cairo_buffer) {
+			return;
+		}
+		entry = text_cache_insert(&key, hash, cairo_buffer);
+		if (!entry) {
+			sway_log(SWAY_ERROR, "text cache entry allocation failed");
+			wlr_buffer_drop(&cairo_buffer->base);
+			return;
+		}
+	}
+
+	text_buffer_set_cached(buffer, entry);
 
 	pixman_region32_t opaque;
 	pixman_region32_init(&opaque);
-	if (background[3] == 1) {
+	if (key.background[3] == 1) {
 		pixman_region32_union_rect(&opaque, &opaque, 0, 0,
 			get_text_width(&buffer->props), buffer->props.height);
 	}
 	wlr_scene_buffer_set_opaque_region(buffer->buffer_node, &opaque);
 	pixman_region32_fini(&opaque);
-
-err:
-	if (pango) g_object_unref(pango);
-	cairo_font_options_destroy(fo);
 }
 
 static void handle_outputs_update(struct wl_listener *listener, void *data) {
@@ -191,6 +413,7 @@ static void handle_destroy(struct wl_listener *listener, void *data) {
 	wl_list_remove(&buffer->outputs_update.link);
 	wl_list_remove(&buffer->destroy.link);
 
+	text_cache_entry_unref(buffer->cached);
 	free(buffer->text);
 	free(buffer);
 }
@@ -511,6 +511,8 @@ void container_destroy(struct sway_container *con) {
 	free(con->title);
 	free(con->formatted_title);
 	free(con->title_format);
+	free(con->node.ipc_json);
+	free(con->node.ipc_cbor);
 	list_free(con->pending.children);
 	list_free(con->current.children);
 
@@ -1,3 +1,4 @@
+#include "sway/ipc-json.h"
 #include "sway/output.h"
 #include "sway/server.h"
 #include "sway/tree/container.h"
@@ -11,6 +12,7 @@ void node_init(struct sway_node *node, enum sway_node_type type, void *thing) {
 	node->id = next_id++;
 	node->type = type;
 	node->sway_root = thing;
+	wl_list_init(&node->seat_nodes);
 	wl_signal_init(&node->events.destroy);
 }
 
@@ -29,7 +31,11 @@ const char *node_type_to_str(enum sway_node_type type) {
 }
 
 void node_set_dirty(struct sway_node *node) {
-	if (node->dirty || node->destroying) {
+	if (node->destroying) {
+		return;
+	}
+	ipc_json_invalidate_node(node);
+	if (node->dirty) {
 		return;
 	}
 	node->dirty = true;
@@ -270,6 +270,8 @@ void output_destroy(struct sway_output *output) {
 	list_free(output->workspaces);
 	list_free(output->current.workspaces);
 	wlr_color_transform_unref(output->color_transform);
+	free(output->node.ipc_json);
+	free(output->node.ipc_cbor);
 	free(output);
 }
 
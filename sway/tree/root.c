@@ -83,6 +83,8 @@ void root_destroy(struct sway_root *root) {
 	list_free(root->non_desktop_outputs);
 	list_free(root->outputs);
 	wlr_scene_node_destroy(&root->root_scene->tree.node);
+	free(root->node.ipc_json);
+	free(root->node.ipc_cbor);
 	free(root);
 }
 
@@ -24,6 +24,7 @@
 #include "sway/desktop/idle_inhibit_v1.h"
 #include "sway/desktop/launcher.h"
 #include "sway/input/cursor.h"
+#include "sway/ipc-json.h"
 #include "sway/ipc-server.h"
 #include "sway/output.h"
 #include "sway/input/seat.h"
@@ -498,8 +499,8 @@ static bool view_has_executed_criteria(struct sway_view *view,
 	return false;
 }
 
-void view_execute_criteria(struct sway_view *view) {
-	list_t *criterias = criteria_for_view(view, CT_COMMAND);
+void view_execute_criteria(struct sway_view *view, uint32_t changed) {
+	list_t *criterias = criteria_for_view_changed(view, CT_COMMAND, changed);
 	for (int i = 0; i < criterias->length; i++) {
 		struct criteria *criteria = criterias->items[i];
 		sway_log(SWAY_DEBUG, "Checking criteria %s", criteria->raw);
@@ -871,7 +872,7 @@ void view_map(struct sway_view *view, struct wlr_surface *wlr_surface,
 		}
 	}
 
-	view_execute_criteria(view);
+	view_execute_criteria(view, CF_ALL);
 
 	bool set_focus = should_focus(view);
 
@@ -1024,6 +1025,10 @@ struct sway_view *view_from_wlr_surface(struct wlr_surface *wlr_surface) {
 void view_update_app_id(struct sway_view *view) {
 	const char *app_id = view_get_app_id(view);
 
+	if (view->container) {
+		ipc_json_invalidate_node(&view->container->node);
+	}
+
 	if (view->foreign_toplevel && app_id) {
 		wlr_foreign_toplevel_handle_v1_set_app_id(view->foreign_toplevel, app_id);
 	}
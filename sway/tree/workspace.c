@@ -150,6 +150,8 @@ void workspace_destroy(struct sway_workspace *workspace) {
 
 	free(workspace->name);
 	free(workspace->representation);
+	free(workspace->node.ipc_json);
+	free(workspace->node.ipc_cbor);
 	list_free_items_and_destroy(workspace->output_priority);
 	list_free(workspace->floating);
 	list_free(workspace->tiling);
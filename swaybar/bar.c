@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <poll.h>
 #include <signal.h>
 #include <stdbool.h>
@@ -19,13 +20,16 @@
 #include "swaybar/status_line.h"
 #include "swaybar/render.h"
 #if HAVE_TRAY
+#include "swaybar/tray/icon.h"
 #include "swaybar/tray/tray.h"
 #endif
 #include "ipc-client.h"
 #include "list.h"
 #include "log.h"
 #include "loop.h"
+#include "pango.h"
 #include "pool-buffer.h"
+#include "util.h"
 #include "wlr-layer-shell-unstable-v1-client-protocol.h"
 #include "xdg-output-unstable-v1-client-protocol.h"
 
@@ -51,8 +55,9 @@ static void swaybar_output_free(struct swaybar_output *output) {
 		wl_surface_destroy(output->surface);
 	}
 	wl_output_destroy(output->output);
-	destroy_buffer(&output->buffers[0]);
-	destroy_buffer(&output->buffers[1]);
+	buffer_pool_finish(&output->pool);
+	free(output->regions);
+	free(output->last_damage);
 	free_hotspots(&output->hotspots);
 	free_workspaces(&output->workspaces);
 	wl_list_remove(&output->link);
@@ -132,6 +137,7 @@ void destroy_layer_surface(struct swaybar_output *output) {
 }
 
 void set_bar_dirty(struct swaybar *bar) {
+	bar->content_serial++;
 	struct swaybar_output *output;
 	wl_list_for_each(output, &bar->outputs, link) {
 		set_output_dirty(output);
@@ -349,6 +355,7 @@ static void handle_global(void *data, struct wl_registry *registry,
 		wl_output_add_listener(output->output, &output_listener, output);
 		output->scale = 1;
 		output->wl_name = name;
+		buffer_pool_init(&output->pool, SWAYBAR_BUFFERS);
 		wl_list_init(&output->workspaces);
 		wl_list_init(&output->hotspots);
 		wl_list_init(&output->link);
@@ -487,15 +494,63 @@ static void ipc_in(int fd, short mask, void *data) {
 	}
 }
 
+static bool bar_redraw_pending(struct swaybar *bar) {
+	if (bar->status_timer) {
+		return true;
+	}
+	struct swaybar_output *output;
+	wl_list_for_each(output, &bar->outputs, link) {
+		if (output->dirty) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void status_update(struct swaybar *bar) {
+	bar->status_update_time = get_current_time_in_msec();
+	set_bar_dirty(bar);
+}
+
+static void status_timer_done(void *data) {
+	struct swaybar *bar = data;
+	bar->status_timer = NULL;
+	status_update(bar);
+}
+
 void status_in(int fd, short mask, void *data) {
 	struct swaybar *bar = data;
 	if (mask & (POLLHUP | POLLERR)) {
 		status_error(bar->status, "[error reading from status command]");
 		set_bar_dirty(bar);
 		loop_remove_fd(bar->eventloop, fd);
-	} else if (status_handle_readable(bar->status)) {
-		set_bar_dirty(bar);
+		return;
+	}
+	if (!status_handle_readable(bar->status)) {
+		return;
+	}
+
+	// Outputs waiting for a frame callback already redraw once it arrives,
+	// and faster status commands are held back to status_max_fps
+	if (bar_redraw_pending(bar)) {
+		bar->status->updates_coalesced++;
+		if (bar->status_timer) {
+			return;
+		}
 	}
+	int max_fps = bar->config->status_max_fps;
+	if (max_fps > 0) {
+		uint32_t interval = 1000 / max_fps;
+		uint32_t elapsed = get_current_time_in_msec() - bar->status_update_time;
+		if (elapsed < interval) {
+			bar->status_timer = loop_add_timer(bar->eventloop,
+					interval - elapsed, status_timer_done, bar);
+			if (bar->status_timer) {
+				return;
+			}
+		}
+	}
+	status_update(bar);
 }
 
 void bar_run(struct swaybar *bar) {
@@ -509,6 +564,10 @@ void bar_run(struct swaybar *bar) {
 #if HAVE_TRAY
 	if (bar->tray) {
 		loop_add_fd(bar->eventloop, bar->tray->fd, POLLIN, tray_in, bar);
+		if (bar->tray->icons->fd != -1) {
+			loop_add_fd(bar->eventloop, bar->tray->icons->fd, POLLIN,
+					tray_icons_in, bar);
+		}
 	}
 #endif
 	while (bar->running) {
@@ -535,6 +594,12 @@ static void free_seats(struct wl_list *list) {
 }
 
 void bar_teardown(struct swaybar *bar) {
+	struct text_stats stats;
+	get_text_stats(&stats);
+	sway_log(SWAY_DEBUG, "Text measurements: %" PRIu64 " hits, %" PRIu64
+			" misses, %" PRIu64 " renders", stats.measure_hits,
+			stats.measure_misses, stats.renders);
+
 #if HAVE_TRAY
 	destroy_tray(bar->tray);
 #endif
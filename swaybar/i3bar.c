@@ -11,12 +11,25 @@
 #include "swaybar/input.h"
 #include "swaybar/status_line.h"
 
+void i3bar_block_surfaces_clear(struct i3bar_block *block) {
+	struct i3bar_block_surface *surface, *tmp;
+	wl_list_for_each_safe(surface, tmp, &block->surfaces, link) {
+		wl_list_remove(&surface->link);
+		cairo_surface_destroy(surface->surface);
+		free(surface);
+	}
+}
+
 void i3bar_block_unref(struct i3bar_block *block) {
 	if (block == NULL) {
 		return;
 	}
 
 	if (--block->ref_count == 0) {
+		i3bar_block_surfaces_clear(block);
+		if (block->measured_font) {
+			pango_font_description_free(block->measured_font);
+		}
 		free(block->full_text);
 		free(block->short_text);
 		free(block->align);
@@ -40,13 +53,121 @@ static bool i3bar_parse_json_color(json_object *json, uint32_t *color) {
 	return color_set;
 }
 
+#define hash_value(hash, value) hash_bytes(hash, &(value), sizeof(value))
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ bytes[i]) * UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+static uint64_t hash_str(uint64_t hash, const char *str) {
+	if (!str) {
+		// Distinct from the empty string
+		return hash_bytes(hash, "\xff", 1);
+	}
+	return hash_bytes(hash, str, strlen(str) + 1);
+}
+
+static uint64_t i3bar_block_hash(struct i3bar_block *block) {
+	uint64_t hash = hash_str(UINT64_C(14695981039346656037), block->full_text);
+	hash = hash_str(hash, block->short_text);
+	hash = hash_str(hash, block->align);
+	hash = hash_str(hash, block->min_width_str);
+	hash = hash_value(hash, block->urgent);
+	hash = hash_value(hash, block->color_set);
+	hash = hash_value(hash, block->color);
+	hash = hash_value(hash, block->min_width);
+	hash = hash_value(hash, block->separator);
+	hash = hash_value(hash, block->separator_block_width);
+	hash = hash_value(hash, block->markup);
+	hash = hash_value(hash, block->background);
+	hash = hash_value(hash, block->border_set);
+	hash = hash_value(hash, block->border);
+	hash = hash_value(hash, block->border_top);
+	hash = hash_value(hash, block->border_bottom);
+	hash = hash_value(hash, block->border_left);
+	hash = hash_value(hash, block->border_right);
+	return hash;
+}
+
+static bool str_equal(const char *a, const char *b) {
+	return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/**
+ * Whether the old block has a render cache which can be used for the block,
+ * comparing everything i3bar_block_hash covers.
+ */
+static bool i3bar_block_can_adopt(struct i3bar_block *block,
+		struct i3bar_block *old) {
+	return old->measured_font && old->hash == block->hash &&
+		str_equal(old->full_text, block->full_text) &&
+		str_equal(old->short_text, block->short_text) &&
+		str_equal(old->align, block->align) &&
+		str_equal(old->min_width_str, block->min_width_str) &&
+		old->urgent == block->urgent &&
+		old->color_set == block->color_set &&
+		old->color == block->color &&
+		old->min_width == block->min_width &&
+		old->separator == block->separator &&
+		old->separator_block_width == block->separator_block_width &&
+		old->markup == block->markup &&
+		old->background == block->background &&
+		old->border_set == block->border_set &&
+		old->border == block->border &&
+		old->border_top == block->border_top &&
+		old->border_bottom == block->border_bottom &&
+		old->border_left == block->border_left &&
+		old->border_right == block->border_right;
+}
+
+/**
+ * Moves the render cache of an identical block of the previous update over
+ * to the new block. Blocks are usually sent in the same order every time, so
+ * the block at the same position is tried first.
+ */
+static void i3bar_block_adopt_cache(struct i3bar_block *block,
+		struct wl_list *old_blocks, struct i3bar_block *hint) {
+	struct i3bar_block *old = NULL;
+	if (hint && i3bar_block_can_adopt(block, hint)) {
+		old = hint;
+	} else {
+		// Identical blocks may have given their cache to an earlier block
+		struct i3bar_block *iter;
+		wl_list_for_each(iter, old_blocks, link) {
+			if (i3bar_block_can_adopt(block, iter)) {
+				old = iter;
+				break;
+			}
+		}
+	}
+	if (!old) {
+		return;
+	}
+
+	block->measured_font = old->measured_font;
+	block->measured_scale = old->measured_scale;
+	block->size = old->size;
+	old->measured_font = NULL;
+	// Keep the order of the surfaces
+	wl_list_insert_list(&block->surfaces, &old->surfaces);
+	wl_list_init(&old->surfaces);
+}
+
 static void i3bar_parse_json(struct status_line *status,
 		struct json_object *json_array) {
-	struct i3bar_block *block, *tmp;
-	wl_list_for_each_safe(block, tmp, &status->blocks, link) {
-		wl_list_remove(&block->link);
-		i3bar_block_unref(block);
-	}
+	struct wl_list old_blocks;
+	wl_list_init(&old_blocks);
+	wl_list_insert_list(&old_blocks, &status->blocks);
+	wl_list_init(&status->blocks);
+
+	// The old blocks are stored last to first, see below
+	struct i3bar_block *hint = wl_list_empty(&old_blocks) ? NULL :
+		wl_container_of(old_blocks.prev, hint, link);
 	for (size_t i = 0; i < json_object_array_length(json_array); ++i) {
 		json_object *full_text, *short_text, *color, *min_width, *align, *urgent;
 		json_object *name, *instance, *separator, *separator_block_width;
@@ -114,8 +235,122 @@ static void i3bar_parse_json(struct status_line *status,
 		block->border_left = border_left ? json_object_get_int(border_left) : 1;
 		block->border_right = border_right ?
 			json_object_get_int(border_right) : 1;
+
+		wl_list_init(&block->surfaces);
+		block->hash = i3bar_block_hash(block);
+		i3bar_block_adopt_cache(block, &old_blocks, hint);
+		if (hint) {
+			hint = hint->link.prev == &old_blocks ? NULL :
+				wl_container_of(hint->link.prev, hint, link);
+		}
 		wl_list_insert(&status->blocks, &block->link);
 	}
+
+	struct i3bar_block *block, *tmp;
+	wl_list_for_each_safe(block, tmp, &old_blocks, link) {
+		wl_list_remove(&block->link);
+		i3bar_block_unref(block);
+	}
+}
+
+/**
+ * Scans the unread part of the buffer for the boundaries of the elements of
+ * the infinite array, without parsing them. The newest complete element is
+ * stored in frame_start and frame_end, the start of an incomplete one in
+ * element_start.
+ */
+static bool i3bar_scan(struct status_line *status, size_t *element_start,
+		size_t *frame_start, size_t *frame_end) {
+	for (; status->scan_pos < status->buffer_index; ++status->scan_pos) {
+		char c = status->buffer[status->scan_pos];
+		if (status->scan_depth == 0) {
+			if (isspace(c)) {
+				continue;
+			}
+			if (status->expecting_comma) {
+				if (c != ',') {
+					sway_log(SWAY_DEBUG, "Invalid i3bar json: expected ',' but encountered '%c'",
+							c);
+					return false;
+				}
+				status->expecting_comma = false;
+			} else if (c == '[' || c == '{') {
+				*element_start = status->scan_pos;
+				status->scan_depth = 1;
+			} else {
+				sway_log(SWAY_DEBUG, "Invalid i3bar json: expected '[' but encountered '%c'",
+						c);
+				return false;
+			}
+		} else if (status->scan_in_string) {
+			if (status->scan_escaped) {
+				status->scan_escaped = false;
+			} else if (c == '\\') {
+				status->scan_escaped = true;
+			} else if (c == '"') {
+				status->scan_in_string = false;
+			}
+		} else if (c == '"') {
+			status->scan_in_string = true;
+		} else if (c == '[' || c == '{') {
+			++status->scan_depth;
+		} else if ((c == ']' || c == '}') && --status->scan_depth == 0) {
+			if (*frame_end) {
+				status->updates_dropped++;
+			}
+			*frame_start = *element_start;
+			*frame_end = status->scan_pos + 1;
+			status->expecting_comma = true;
+		}
+	}
+	return true;
+}
+
+/**
+ * Keeps the newest complete element for i3bar_parse_pending and drops
+ * everything else that was scanned, growing the buffer if the incomplete
+ * element fills all of it.
+ */
+static bool i3bar_compact(struct status_line *status, size_t *element_start,
+		size_t *frame_start, size_t *frame_end, bool *updated) {
+	if (*frame_end) {
+		size_t len = *frame_end - *frame_start;
+		if (len > status->frame_size) {
+			char *frame = realloc(status->frame, len);
+			if (!frame) {
+				status_error(status, "[failed to allocate buffer]");
+				return false;
+			}
+			status->frame = frame;
+			status->frame_size = len;
+		}
+		memcpy(status->frame, &status->buffer[*frame_start], len);
+		status->frame_len = len;
+		if (status->frame_pending) {
+			status->updates_dropped++;
+		}
+		status->frame_pending = true;
+		*frame_start = *frame_end = 0;
+		*updated = true;
+	}
+
+	size_t keep = status->scan_depth ? *element_start : status->scan_pos;
+	status->buffer_index -= keep;
+	status->scan_pos -= keep;
+	memmove(status->buffer, &status->buffer[keep], status->buffer_index);
+	*element_start = 0;
+
+	if (status->buffer_index == status->buffer_size) {
+		size_t size = status->buffer_size * 2;
+		char *buffer = realloc(status->buffer, size);
+		if (!buffer) {
+			status_error(status, "[failed to allocate buffer]");
+			return false;
+		}
+		status->buffer = buffer;
+		status->buffer_size = size;
+	}
+	return true;
 }
 
 bool i3bar_handle_readable(struct status_line *status) {
@@ -149,96 +384,21 @@ bool i3bar_handle_readable(struct status_line *status) {
 		}
 	}
 
-	struct json_object *last_object = NULL;
-	struct json_object *test_object;
-	size_t buffer_pos = 0;
+	// The stream is an infinite array of status updates, of which only the
+	// newest complete one is shown. Elements are delimited by tracking their
+	// nesting depth instead of parsing them, and the newest one is only
+	// parsed once it is about to be rendered, see i3bar_parse_pending.
+	size_t element_start = 0;
+	size_t frame_start = 0, frame_end = 0;
+	bool updated = false;
 	while (true) {
-		// since the incoming stream is an infinite array
-		// parsing is split into two parts
-		// first, attempt to parse the current object, reading more if the
-		// parser indicates that the current object is incomplete, and failing
-		// if the parser fails
-		// second, look for separating comma, ignoring whitespace, failing if
-		// any other characters are encountered
-		if (status->expecting_comma) {
-			for (; buffer_pos < status->buffer_index; ++buffer_pos) {
-				if (status->buffer[buffer_pos] == ',') {
-					status->expecting_comma = false;
-					++buffer_pos;
-					break;
-				} else if (!isspace(status->buffer[buffer_pos])) {
-					sway_log(SWAY_DEBUG, "Invalid i3bar json: expected ',' but encountered '%c'",
-							status->buffer[buffer_pos]);
-					status_error(status, "[invalid i3bar json]");
-					return true;
-				}
-			}
-			if (buffer_pos < status->buffer_index) {
-				continue; // look for new object without reading more input
-			}
-			buffer_pos = status->buffer_index = 0;
-		} else {
-			test_object = json_tokener_parse_ex(status->tokener,
-					&status->buffer[buffer_pos], status->buffer_index - buffer_pos);
-			enum json_tokener_error err = json_tokener_get_error(status->tokener);
-			if (err == json_tokener_success) {
-				if (json_object_get_type(test_object) == json_type_array) {
-					if (last_object) {
-						json_object_put(last_object);
-					}
-					last_object = test_object;
-				} else {
-					json_object_put(test_object);
-				}
-
-				// in order to print the json for debugging purposes
-				// the last character is temporarily replaced with a null character
-				// (the last character is used in case the buffer is full)
-				char *last_char_pos =
-					&status->buffer[buffer_pos + status->tokener->char_offset - 1];
-				char last_char = *last_char_pos;
-				while (isspace(last_char)) {
-					last_char = *--last_char_pos;
-				}
-				*last_char_pos = '\0';
-				size_t offset = strspn(&status->buffer[buffer_pos], " \f\n\r\t\v");
-				sway_log(SWAY_DEBUG, "Received i3bar json: '%s%c'",
-						&status->buffer[buffer_pos + offset], last_char);
-				*last_char_pos = last_char;
-
-				buffer_pos += status->tokener->char_offset;
-				status->expecting_comma = true;
-
-				if (buffer_pos < status->buffer_index) {
-					continue; // look for comma without reading more input
-				}
-				buffer_pos = status->buffer_index = 0;
-			} else if (err == json_tokener_continue) {
-				json_tokener_reset(status->tokener);
-				if (status->buffer_index < status->buffer_size) {
-					// move the object to the start of the buffer
-					status->buffer_index -= buffer_pos;
-					memmove(status->buffer, &status->buffer[buffer_pos],
-							status->buffer_index);
-					buffer_pos = 0;
-				} else {
-					// expand buffer
-					status->buffer_size *= 2;
-					char *new_buffer = realloc(status->buffer, status->buffer_size);
-					if (new_buffer) {
-						status->buffer = new_buffer;
-					} else {
-						free(status->buffer);
-						status_error(status, "[failed to allocate buffer]");
-						return true;
-					}
-				}
-			} else {
-				char last_char = status->buffer[status->buffer_index - 1];
-				status->buffer[status->buffer_index - 1] = '\0';
-				sway_log(SWAY_DEBUG, "Failed to parse i3bar json - %s: '%s%c'",
-						json_tokener_error_desc(err), &status->buffer[buffer_pos], last_char);
-				status_error(status, "[failed to parse i3bar json]");
+		if (!i3bar_scan(status, &element_start, &frame_start, &frame_end)) {
+			status_error(status, "[invalid i3bar json]");
+			return true;
+		}
+		if (status->buffer_index == status->buffer_size) {
+			if (!i3bar_compact(status, &element_start, &frame_start,
+					&frame_end, &updated)) {
 				return true;
 			}
 		}
@@ -246,9 +406,9 @@ bool i3bar_handle_readable(struct status_line *status) {
 		errno = 0;
 		ssize_t read_bytes = read(status->read_fd, &status->buffer[status->buffer_index],
 				status->buffer_size - status->buffer_index);
-		if (read_bytes > -1) {
+		if (read_bytes > 0) {
 			status->buffer_index += read_bytes;
-		} else if (errno == EAGAIN) {
+		} else if (read_bytes == 0 || errno == EAGAIN) {
 			break;
 		} else {
 			status_error(status, "[error reading from status command]");
@@ -256,14 +416,37 @@ bool i3bar_handle_readable(struct status_line *status) {
 		}
 	}
 
-	if (last_object) {
-		sway_log(SWAY_DEBUG, "Rendering last received json");
-		i3bar_parse_json(status, last_object);
-		json_object_put(last_object);
+	if (!i3bar_compact(status, &element_start, &frame_start, &frame_end,
+			&updated)) {
 		return true;
-	} else {
-		return false;
 	}
+	return updated;
+}
+
+void i3bar_parse_pending(struct status_line *status) {
+	if (!status->frame_pending) {
+		return;
+	}
+	status->frame_pending = false;
+	sway_log(SWAY_DEBUG, "Received i3bar json: '%.*s'",
+			(int)status->frame_len, status->frame);
+
+	json_tokener_reset(status->tokener);
+	json_object *json = json_tokener_parse_ex(status->tokener,
+			status->frame, status->frame_len);
+	enum json_tokener_error err = json_tokener_get_error(status->tokener);
+	if (err != json_tokener_success) {
+		sway_log(SWAY_DEBUG, "Failed to parse i3bar json - %s: '%.*s'",
+				json_tokener_error_desc(err), (int)status->frame_len,
+				status->frame);
+		json_object_put(json);
+		status_error(status, "[failed to parse i3bar json]");
+		return;
+	}
+	if (json_object_get_type(json) == json_type_array) {
+		i3bar_parse_json(status, json);
+	}
+	json_object_put(json);
 }
 
 enum hotspot_event_handling i3bar_block_send_click(struct status_line *status,
@@ -10,6 +10,7 @@
 #if HAVE_TRAY
 #include "swaybar/tray/tray.h"
 #endif
+#include "cbor.h"
 #include "config.h"
 #include "ipc-client.h"
 #include "list.h"
@@ -94,15 +95,46 @@ static void ipc_parse_colors(
 	}
 }
 
+static json_object *ipc_parse_payload(bool cbor,
+		const char *payload, uint32_t size) {
+	if (cbor) {
+		json_object *result = cbor_parse((const uint8_t *)payload, size,
+				JSON_MAX_DEPTH);
+		if (!result) {
+			sway_log(SWAY_ERROR, "failed to parse payload as cbor");
+		}
+		return result;
+	}
+
+	// The default depth of 32 is too small to represent some nested layouts, but
+	// we can't pass INT_MAX here because json-c (as of this writing) prefaults
+	// all the memory for its stack.
+	json_tokener *tok = json_tokener_new_ex(JSON_MAX_DEPTH);
+	if (!tok) {
+		sway_log_errno(SWAY_ERROR, "failed to create tokener");
+		return NULL;
+	}
+
+	json_object *result = json_tokener_parse_ex(tok, payload, size);
+	enum json_tokener_error err = json_tokener_get_error(tok);
+	json_tokener_free(tok);
+
+	if (err != json_tokener_success) {
+		sway_log(SWAY_ERROR, "failed to parse payload as json: %s",
+				json_tokener_error_desc(err));
+		json_object_put(result);
+		return NULL;
+	}
+	return result;
+}
+
 static bool ipc_parse_config(
-		struct swaybar_config *config, const char *payload) {
-	json_object *bar_config = json_tokener_parse(payload);
+		struct swaybar_config *config, json_object *bar_config) {
 	json_object *success;
 	if (json_object_object_get_ex(bar_config, "success", &success)
 			&& !json_object_get_boolean(success)) {
 		sway_log(SWAY_ERROR, "No bar with that ID. Use 'swaymsg -t "
 				"get_bar_config' to get the available bar configs.");
-		json_object_put(bar_config);
 		return false;
 	}
 
@@ -246,6 +278,12 @@ static bool ipc_parse_config(
 		config->status_edge_padding = json_object_get_int(status_edge_padding);
 	}
 
+	json_object *status_max_fps =
+		json_object_object_get(bar_config, "status_max_fps");
+	if (status_max_fps) {
+		config->status_max_fps = json_object_get_int(status_max_fps);
+	}
+
 	json_object *status_padding =
 		json_object_object_get(bar_config, "status_padding");
 	if (status_padding) {
@@ -333,7 +371,6 @@ static bool ipc_parse_config(
 	}
 #endif
 
-	json_object_put(bar_config);
 	return true;
 }
 
@@ -346,7 +383,7 @@ bool ipc_get_workspaces(struct swaybar *bar) {
 	uint32_t len = 0;
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_WORKSPACES, NULL, &len);
-	json_object *results = json_tokener_parse(res);
+	json_object *results = ipc_parse_payload(bar->ipc_cbor, res, len);
 	if (!results) {
 		free(res);
 		return false;
@@ -417,14 +454,24 @@ void ipc_execute_binding(struct swaybar *bar, struct swaybar_binding *bind) {
 }
 
 bool ipc_initialize(struct swaybar *bar) {
+	// CBOR spares swaybar tokenizing the text of the workspace events and
+	// replies. Each socket keeps its own encoding, as either request may fail.
+	bar->ipc_cbor = ipc_set_encoding(bar->ipc_socketfd, "cbor");
+	bar->ipc_event_cbor = ipc_set_encoding(bar->ipc_event_socketfd, "cbor");
+
 	uint32_t len = strlen(bar->id);
 	char *res = ipc_single_command(bar->ipc_socketfd,
 			IPC_GET_BAR_CONFIG, bar->id, &len);
-	if (!ipc_parse_config(bar->config, res)) {
-		free(res);
+	json_object *bar_config = ipc_parse_payload(bar->ipc_cbor, res, len);
+	free(res);
+	if (!bar_config) {
+		return false;
+	}
+	bool success = ipc_parse_config(bar->config, bar_config);
+	json_object_put(bar_config);
+	if (!success) {
 		return false;
 	}
-	free(res);
 
 	char *subscribe =
 		"[ \"barconfig_update\", \"bar_state_update\", \"mode\", \"workspace\" ]";
@@ -455,7 +502,7 @@ static bool handle_bar_state_update(struct swaybar *bar, json_object *event) {
 	return determine_bar_visibility(bar, false);
 }
 
-static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
+static bool handle_barconfig_update(struct swaybar *bar,
 		json_object *json_config) {
 	json_object *json_id = json_object_object_get(json_config, "id");
 	const char *id = json_object_get_string(json_id);
@@ -464,13 +511,14 @@ static bool handle_barconfig_update(struct swaybar *bar, const char *payload,
 	}
 
 	struct swaybar_config *newcfg = init_config();
-	ipc_parse_config(newcfg, payload);
+	ipc_parse_config(newcfg, json_config);
 
 	struct swaybar_config *oldcfg = bar->config;
 	bar->config = newcfg;
 
 	struct swaybar_output *output, *tmp_output;
 	wl_list_for_each_safe(output, tmp_output, &bar->outputs, link) {
+		output->damage_all = true;
 		bool found = wl_list_empty(&newcfg->outputs);
 		struct config_output *coutput;
 		wl_list_for_each(coutput, &newcfg->outputs, link) {
@@ -544,23 +592,9 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		return false;
 	}
 
-	// The default depth of 32 is too small to represent some nested layouts, but
-	// we can't pass INT_MAX here because json-c (as of this writing) prefaults
-	// all the memory for its stack.
-	json_tokener *tok = json_tokener_new_ex(JSON_MAX_DEPTH);
-	if (!tok) {
-		sway_log_errno(SWAY_ERROR, "failed to create tokener");
-		free_ipc_response(resp);
-		return false;
-	}
-
-	json_object *result = json_tokener_parse_ex(tok, resp->payload, -1);
-	enum json_tokener_error err = json_tokener_get_error(tok);
-	json_tokener_free(tok);
-
-	if (err != json_tokener_success) {
-		sway_log(SWAY_ERROR, "failed to parse payload as json: %s",
-				json_tokener_error_desc(err));
+	json_object *result = ipc_parse_payload(bar->ipc_event_cbor,
+			resp->payload, resp->size);
+	if (!result) {
 		free_ipc_response(resp);
 		return false;
 	}
@@ -590,7 +624,7 @@ bool handle_ipc_readable(struct swaybar *bar) {
 		break;
 	}
 	case IPC_EVENT_BARCONFIG_UPDATE:
-		bar_is_dirty = handle_barconfig_update(bar, resp->payload, result);
+		bar_is_dirty = handle_barconfig_update(bar, result);
 		break;
 	case IPC_EVENT_BAR_STATE_UPDATE:
 		bar_is_dirty = handle_bar_state_update(bar, result);
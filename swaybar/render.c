@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <linux/input-event-codes.h>
 #include <limits.h>
+#include <math.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -14,6 +15,7 @@
 #include "swaybar/render.h"
 #include "swaybar/status_line.h"
 #if HAVE_TRAY
+#include "swaybar/tray/item.h"
 #include "swaybar/tray/tray.h"
 #endif
 #include "wlr-layer-shell-unstable-v1-client-protocol.h"
@@ -21,16 +23,81 @@
 static const int WS_HORIZONTAL_PADDING = 5;
 static const double WS_VERTICAL_PADDING = 1.5;
 static const int BORDER_WIDTH = 1;
-
+// Text may be drawn slightly outside of its logical extents
+static const int REGION_PADDING = 2;
+
+/**
+ * Each frame walks the bar twice with the same context: a layout pass which
+ * only measures, creating the hotspots and regions and working out the
+ * height, and a draw pass which paints directly into the shm buffer.
+ */
 struct render_context {
 	cairo_t *cairo;
+	bool draw;
 	struct swaybar_output *output;
 	cairo_font_options_t *textaa_sharp;
 	cairo_font_options_t *textaa_safe;
 	uint32_t background_color;
 	bool has_transparency;
+	bool use_short_text; // decided in the layout pass
+
+	// Regions drawn in this frame, see render_frame
+	struct swaybar_render_region *regions;
+	size_t regions_len, regions_cap;
+	bool regions_failed;
 };
 
+#define HASH_INIT UINT64_C(14695981039346656037)
+#define hash_value(hash, value) hash_bytes(hash, &(value), sizeof(value))
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ bytes[i]) * UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
+static uint64_t hash_str(uint64_t hash, const char *str) {
+	if (!str) {
+		str = "";
+	}
+	return hash_bytes(hash, str, strlen(str) + 1);
+}
+
+/**
+ * Records that the bar between x0 and x1 was drawn from the state summarized
+ * by the hash, which must cover everything that affects those pixels apart
+ * from the frame key computed in render_frame.
+ */
+static void add_region(struct render_context *ctx, double x0, double x1,
+		uint64_t hash) {
+	if (ctx->draw || x1 <= x0) {
+		return;
+	}
+	hash = hash_value(hash, x0);
+	hash = hash_value(hash, x1);
+
+	if (ctx->regions_len == ctx->regions_cap) {
+		size_t cap = ctx->regions_cap ? ctx->regions_cap * 2 : 16;
+		struct swaybar_render_region *regions =
+			realloc(ctx->regions, cap * sizeof(*regions));
+		if (!regions) {
+			ctx->regions_failed = true;
+			return;
+		}
+		ctx->regions = regions;
+		ctx->regions_cap = cap;
+	}
+	int x = (int)floor(x0) - REGION_PADDING;
+	ctx->regions[ctx->regions_len++] = (struct swaybar_render_region){
+		.x = x,
+		.width = (int)ceil(x1) + REGION_PADDING - x,
+		.hash = hash,
+	};
+}
+
 static void choose_text_aa_mode(struct render_context *ctx, uint32_t fontcolor) {
 	uint32_t salpha = fontcolor & 0xFF;
 	uint32_t balpha = ctx->background_color & 0xFF;
@@ -56,7 +123,6 @@ static uint32_t render_status_line_error(struct render_context *ctx, double *x)
 	uint32_t height = output->height;
 
 	cairo_t *cairo = ctx->cairo;
-	cairo_set_source_u32(cairo, 0xFF0000FF);
 
 	int margin = 3;
 	double ws_vertical_padding = output->bar->config->status_padding;
@@ -72,13 +138,21 @@ static uint32_t render_status_line_error(struct render_context *ctx, double *x)
 			output->height < ideal_surface_height) {
 		return ideal_surface_height;
 	}
+	double x_end = *x;
 	*x -= text_width + margin;
 
-	double text_y = height / 2.0 - text_height / 2.0;
-	cairo_move_to(cairo, *x, (int)floor(text_y));
-	choose_text_aa_mode(ctx, 0xFF0000FF);
-	render_text(cairo, font, 1, false, "%s", error);
+	if (ctx->draw) {
+		double text_y = height / 2.0 - text_height / 2.0;
+		cairo_set_source_u32(cairo, 0xFF0000FF);
+		cairo_move_to(cairo, *x, (int)floor(text_y));
+		choose_text_aa_mode(ctx, 0xFF0000FF);
+		render_text(cairo, font, 1, false, "%s", error);
+	}
 	*x -= margin;
+
+	uint64_t hash = hash_str(HASH_INIT, error);
+	hash = hash_value(hash, ctx->background_color);
+	add_region(ctx, *x, x_end, hash);
 	return output->height;
 }
 
@@ -93,7 +167,6 @@ static uint32_t render_status_line_text(struct render_context *ctx, double *x) {
 	struct swaybar_config *config = output->bar->config;
 	uint32_t fontcolor = output->focused ?
 			config->colors.focused_statusline : config->colors.statusline;
-	cairo_set_source_u32(cairo, fontcolor);
 
 	int text_width, text_height;
 	get_text_size(cairo, config->font_description, &text_width, &text_height, NULL,
@@ -109,13 +182,23 @@ static uint32_t render_status_line_text(struct render_context *ctx, double *x) {
 		return ideal_surface_height;
 	}
 
+	double x_end = *x;
 	*x -= text_width + margin;
-	uint32_t height = output->height;
-	double text_y = height / 2.0 - text_height / 2.0;
-	cairo_move_to(cairo, *x, (int)floor(text_y));
-	choose_text_aa_mode(ctx, fontcolor);
-	render_text(cairo, config->font_description, 1, config->pango_markup, "%s", text);
+	if (ctx->draw) {
+		uint32_t height = output->height;
+		double text_y = height / 2.0 - text_height / 2.0;
+		cairo_set_source_u32(cairo, fontcolor);
+		cairo_move_to(cairo, *x, (int)floor(text_y));
+		choose_text_aa_mode(ctx, fontcolor);
+		render_text(cairo, config->font_description, 1,
+				config->pango_markup, "%s", text);
+	}
 	*x -= margin;
+
+	uint64_t hash = hash_str(HASH_INIT, text);
+	hash = hash_value(hash, fontcolor);
+	hash = hash_value(hash, ctx->background_color);
+	add_region(ctx, *x, x_end, hash);
 	return output->height;
 }
 
@@ -174,36 +257,220 @@ static void i3bar_block_unref_callback(void *data) {
 	i3bar_block_unref(data);
 }
 
+static void *i3bar_block_ref_callback(void *data) {
+	struct i3bar_block *block = data;
+	block->ref_count++;
+	return block;
+}
+
+/**
+ * Returns the text sizes of the block, which are only measured again if the
+ * font or the scale changed.
+ */
+static const struct i3bar_block_size *get_status_block_size(cairo_t *cairo,
+		struct swaybar_output *output, struct i3bar_block *block) {
+	const PangoFontDescription *font = output->bar->config->font_description;
+	bool same_font = block->measured_font &&
+		pango_font_description_equal(block->measured_font, font);
+	if (same_font && block->measured_scale == output->scale) {
+		return &block->size;
+	}
+	if (!same_font) {
+		// The rasterized text is only valid for the font it was drawn with
+		i3bar_block_surfaces_clear(block);
+		if (block->measured_font) {
+			pango_font_description_free(block->measured_font);
+		}
+		block->measured_font = pango_font_description_copy(font);
+	}
+	block->measured_scale = output->scale;
+
+	struct i3bar_block_size *size = &block->size;
+	get_text_size(cairo, font, &size->full_width, &size->full_height, NULL, 1,
+			block->markup, "%s", block->full_text);
+	if (block->short_text && *block->short_text) {
+		get_text_size(cairo, font, &size->short_width, &size->short_height,
+				NULL, 1, block->markup, "%s", block->short_text);
+	} else {
+		size->short_width = size->full_width;
+		size->short_height = size->full_height;
+	}
+	size->min_width = block->min_width;
+	if (block->min_width_str) {
+		get_text_size(cairo, font, &size->min_width, NULL, NULL, 1,
+				block->markup, "%s", block->min_width_str);
+	}
+	return size;
+}
+
+#define BLOCK_SURFACES_MAX 8
+
+static struct i3bar_block_surface *rasterize_block_text(
+		struct render_context *ctx, struct i3bar_block *block,
+		const char *text, cairo_font_options_t *fo,
+		struct i3bar_block_surface *key) {
+	struct swaybar_output *output = ctx->output;
+	PangoLayout *layout = get_pango_layout(ctx->cairo,
+			output->bar->config->font_description, text, 1, block->markup);
+	pango_cairo_context_set_font_options(pango_layout_get_context(layout), fo);
+	pango_layout_context_changed(layout);
+
+	PangoRectangle ink, logical;
+	pango_layout_get_extents(layout, &ink, &logical);
+	double scale = (double)output->scale / PANGO_SCALE;
+	int x0 = floor(key->phase + fmin(ink.x, logical.x) * scale) - 1;
+	int y0 = floor(fmin(ink.y, logical.y) * scale) - 1;
+	int x1 = ceil(key->phase + fmax(ink.x + ink.width,
+			logical.x + logical.width) * scale) + 1;
+	int y1 = ceil(fmax(ink.y + ink.height,
+			logical.y + logical.height) * scale) + 1;
+
+	struct i3bar_block_surface *entry = calloc(1, sizeof(*entry));
+	if (!entry) {
+		g_object_unref(layout);
+		return NULL;
+	}
+	*entry = *key;
+	entry->x = x0;
+	entry->y = y0;
+	entry->surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+			x1 - x0, y1 - y0);
+	if (cairo_surface_status(entry->surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(entry->surface);
+		free(entry);
+		g_object_unref(layout);
+		return NULL;
+	}
+
+	cairo_t *cairo = cairo_create(entry->surface);
+	if (entry->subpixel_aa) {
+		cairo_set_source_u32(cairo, entry->background);
+		cairo_paint(cairo);
+	}
+	cairo_translate(cairo, entry->phase - x0, -y0);
+	cairo_scale(cairo, output->scale, output->scale);
+	cairo_set_font_options(cairo, fo);
+	cairo_set_operator(cairo, CAIRO_OPERATOR_OVER);
+	cairo_set_source_u32(cairo, entry->color);
+	cairo_move_to(cairo, 0, 0);
+	pango_cairo_update_layout(cairo, layout);
+	pango_cairo_show_layout(cairo, layout);
+	cairo_destroy(cairo);
+	g_object_unref(layout);
+
+	wl_list_insert(&block->surfaces, &entry->link);
+	if (wl_list_length(&block->surfaces) > BLOCK_SURFACES_MAX) {
+		struct i3bar_block_surface *last =
+			wl_container_of(block->surfaces.prev, last, link);
+		wl_list_remove(&last->link);
+		cairo_surface_destroy(last->surface);
+		free(last);
+	}
+	return entry;
+}
+
+/**
+ * Draws the text of a block from its cached rasterization, creating it if
+ * needed. Returns false if the text has to be drawn directly instead: text
+ * which isn't opaque is drawn with the SOURCE operator, and subpixel
+ * antialiased text can only be cached if the pixels underneath are known.
+ */
+static bool render_status_block_text(struct render_context *ctx,
+		struct i3bar_block *block, const char *text, bool short_text,
+		uint32_t color, double x, double y, bool known_background,
+		uint32_t background, double bg_x, double bg_y, double bg_width,
+		double bg_height) {
+	struct swaybar_output *output = ctx->output;
+	if ((color & 0xFF) != 0xFF) {
+		return false;
+	}
+	bool subpixel_aa = (ctx->background_color & 0xFF) == 0xFF &&
+		ctx->textaa_sharp != ctx->textaa_safe;
+	if (subpixel_aa && (!known_background || (background & 0xFF) != 0xFF)) {
+		return false;
+	}
+
+	int scale = output->scale;
+	double origin_x = floor(x * scale);
+	struct i3bar_block_surface key = {
+		.scale = scale,
+		.short_text = short_text,
+		.color = color,
+		.phase = x * scale - origin_x,
+		.subpixel_aa = subpixel_aa,
+		.background = subpixel_aa ? background : 0,
+		.subpixel_order = subpixel_aa ?
+			to_cairo_subpixel_order(output->subpixel) : 0,
+	};
+
+	struct i3bar_block_surface *entry = NULL, *iter;
+	wl_list_for_each(iter, &block->surfaces, link) {
+		if (iter->scale == key.scale && iter->short_text == key.short_text &&
+				iter->color == key.color && iter->phase == key.phase &&
+				iter->subpixel_aa == key.subpixel_aa &&
+				iter->background == key.background &&
+				iter->subpixel_order == key.subpixel_order) {
+			entry = iter;
+			wl_list_remove(&entry->link);
+			wl_list_insert(&block->surfaces, &entry->link);
+			break;
+		}
+	}
+	if (!entry) {
+		entry = rasterize_block_text(ctx, block, text, subpixel_aa ?
+				ctx->textaa_sharp : ctx->textaa_safe, &key);
+		if (!entry) {
+			return false;
+		}
+	}
+
+	int width = cairo_image_surface_get_width(entry->surface);
+	int height = cairo_image_surface_get_height(entry->surface);
+	double surface_x = origin_x + entry->x;
+	double surface_y = y * scale + entry->y;
+	if (subpixel_aa && (surface_x < bg_x * scale || surface_y < bg_y * scale ||
+			surface_x + width > (bg_x + bg_width) * scale ||
+			surface_y + height > (bg_y + bg_height) * scale)) {
+		// The background drawn along with the text would show
+		return false;
+	}
+
+	cairo_t *cairo = ctx->cairo;
+	cairo_save(cairo);
+	cairo_scale(cairo, 1.0 / scale, 1.0 / scale);
+	cairo_set_operator(cairo, subpixel_aa ?
+			CAIRO_OPERATOR_SOURCE : CAIRO_OPERATOR_OVER);
+	cairo_set_source_surface(cairo, entry->surface, surface_x, surface_y);
+	cairo_rectangle(cairo, surface_x, surface_y, width, height);
+	cairo_fill(cairo);
+	cairo_restore(cairo);
+	return true;
+}
+
 static uint32_t render_status_block(struct render_context *ctx,
 		struct i3bar_block *block, double *x, bool edge, bool use_short_text) {
 	if (!block->full_text || !*block->full_text) {
 		return 0;
 	}
 
-	char* text = block->full_text;
-	if (use_short_text && block->short_text && *block->short_text) {
-		text = block->short_text;
-	}
-
 	cairo_t *cairo = ctx->cairo;
 	struct swaybar_output *output = ctx->output;
 	struct swaybar_config *config = output->bar->config;
-	int text_width, text_height;
-	get_text_size(cairo, config->font_description, &text_width, &text_height, NULL, 1,
-			block->markup, "%s", text);
+	const struct i3bar_block_size *size =
+		get_status_block_size(cairo, output, block);
+
+	bool short_text = use_short_text &&
+		block->short_text && *block->short_text;
+	char *text = short_text ? block->short_text : block->full_text;
+	int text_width = short_text ? size->short_width : size->full_width;
+	int text_height = short_text ? size->short_height : size->full_height;
 
 	int margin = 3;
 	double ws_vertical_padding = config->status_padding;
 
 	int width = text_width;
-	if (block->min_width_str) {
-		int w;
-		get_text_size(cairo, config->font_description, &w, NULL, NULL, 1, block->markup,
-				"%s", block->min_width_str);
-		block->min_width = w;
-	}
-	if (width < block->min_width) {
-		width = block->min_width;
+	if (width < size->min_width) {
+		width = size->min_width;
 	}
 
 	double block_width = width;
@@ -214,6 +481,11 @@ static uint32_t render_status_block(struct render_context *ctx,
 		return ideal_surface_height;
 	}
 
+	// The text antialiasing depends on the background drawn before
+	uint64_t hash = hash_str(HASH_INIT, text);
+	hash = hash_value(hash, block->markup);
+	hash = hash_value(hash, ctx->background_color);
+	double x_end = *x;
 	*x -= width;
 	if ((block->border_set || block->urgent) && block->border_left > 0) {
 		*x -= (block->border_left + margin);
@@ -246,7 +518,7 @@ static uint32_t render_status_block(struct render_context *ctx,
 	}
 
 	uint32_t height = output->height;
-	if (output->bar->status->click_events) {
+	if (!ctx->draw && output->bar->status->click_events) {
 		struct swaybar_hotspot *hotspot = calloc(1, sizeof(struct swaybar_hotspot));
 		hotspot->x = *x;
 		hotspot->y = 0;
@@ -254,6 +526,7 @@ static uint32_t render_status_block(struct render_context *ctx,
 		hotspot->height = height;
 		hotspot->callback = block_hotspot_callback;
 		hotspot->destroy = i3bar_block_unref_callback;
+		hotspot->copy = i3bar_block_ref_callback;
 		hotspot->data = block;
 		block->ref_count++;
 		wl_list_insert(&output->hotspots, &hotspot->link);
@@ -267,14 +540,17 @@ static uint32_t render_status_block(struct render_context *ctx,
 		? config->colors.urgent_workspace.background : block->background;
 	ctx->has_transparency |= (bg_color & 0xFF) != 0xFF;
 	if (bg_color) {
-		render_sharp_rectangle(cairo, bg_color, x_pos, y_pos,
-				block_width, render_height);
+		if (ctx->draw) {
+			render_sharp_rectangle(cairo, bg_color, x_pos, y_pos,
+					block_width, render_height);
+		}
 		ctx->background_color = bg_color;
 	}
+	double body_x = x_pos;
 
 	uint32_t border_color = block->urgent
 		? config->colors.urgent_workspace.border : block->border;
-	if (block->border_set || block->urgent) {
+	if (ctx->draw && (block->border_set || block->urgent)) {
 		if (block->border_top > 0) {
 			render_sharp_line(cairo, border_color, x_pos, y_pos,
 					block_width, block->border_top);
@@ -288,6 +564,8 @@ static uint32_t render_status_block(struct render_context *ctx,
 			render_sharp_line(cairo, border_color, x_pos, y_pos,
 					block->border_left, render_height);
 		}
+	}
+	if (block->border_set || block->urgent) {
 		x_pos += block->border_left + margin;
 	}
 
@@ -300,19 +578,46 @@ static uint32_t render_status_block(struct render_context *ctx,
 		offset = x_pos + (width - text_width) / 2;
 	}
 	double text_y = height / 2.0 - text_height / 2.0;
-	cairo_move_to(cairo, offset, (int)floor(text_y));
 	uint32_t color = output->focused ?
 		config->colors.focused_statusline : config->colors.statusline;
 	color = block->color_set ? block->color : color;
 	color = block->urgent ? config->colors.urgent_workspace.text : color;
-	cairo_set_source_u32(cairo, color);
-	choose_text_aa_mode(ctx, color);
-	render_text(cairo, config->font_description, 1, block->markup, "%s", text);
+
+	// Without a background or border of its own, the text is drawn on the
+	// bar background
+	bool has_border = block->border_set || block->urgent;
+	uint32_t bar_color = output->focused ?
+		config->colors.focused_background : config->colors.background;
+	bool known_background = bg_color || !has_border;
+	if (ctx->draw && !render_status_block_text(ctx, block, text,
+			short_text, color, offset, (int)floor(text_y), known_background,
+			bg_color ? bg_color : bar_color, body_x,
+			bg_color ? y_pos : 0, block_width,
+			bg_color ? render_height : height)) {
+		cairo_move_to(cairo, offset, (int)floor(text_y));
+		cairo_set_source_u32(cairo, color);
+		choose_text_aa_mode(ctx, color);
+		render_text(cairo, config->font_description, 1, block->markup,
+				"%s", text);
+	}
 	x_pos += width;
 
+	hash = hash_value(hash, bg_color);
+	hash = hash_value(hash, has_border);
+	if (has_border) {
+		hash = hash_value(hash, border_color);
+		hash = hash_value(hash, block->border_top);
+		hash = hash_value(hash, block->border_bottom);
+		hash = hash_value(hash, block->border_left);
+		hash = hash_value(hash, block->border_right);
+	}
+	hash = hash_value(hash, offset);
+	hash = hash_value(hash, color);
+	hash = hash_value(hash, block_width);
+
 	if (block->border_set || block->urgent) {
 		x_pos += margin;
-		if (block->border_right > 0) {
+		if (ctx->draw && block->border_right > 0) {
 			render_sharp_line(cairo, border_color, x_pos, y_pos,
 					block->border_right, render_height);
 		}
@@ -325,22 +630,26 @@ static uint32_t render_status_block(struct render_context *ctx,
 		} else {
 			color = config->colors.separator;
 		}
-		cairo_set_source_u32(cairo, color);
-		if (config->sep_symbol) {
+		if (ctx->draw && config->sep_symbol) {
+			cairo_set_source_u32(cairo, color);
 			offset = x_pos + (sep_block_width - sep_width) / 2;
 			double sep_y = height / 2.0 - sep_height / 2.0;
 			cairo_move_to(cairo, offset, (int)floor(sep_y));
 			choose_text_aa_mode(ctx, color);
 			render_text(cairo, config->font_description, 1, false,
 					"%s", config->sep_symbol);
-		} else {
+		} else if (ctx->draw) {
+			cairo_set_source_u32(cairo, color);
 			cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
 			cairo_set_line_width(cairo, 1);
 			cairo_move_to(cairo, x_pos + sep_block_width / 2, margin);
 			cairo_line_to(cairo, x_pos + sep_block_width / 2, height - margin);
 			cairo_stroke(cairo);
 		}
+		hash = hash_value(hash, color);
+		hash = hash_value(hash, sep_block_width);
 	}
+	add_region(ctx, *x, x_end, hash);
 	return output->height;
 }
 
@@ -352,27 +661,18 @@ static void predict_status_block_pos(cairo_t *cairo,
 	}
 
 	struct swaybar_config *config = output->bar->config;
-
-	int text_width, text_height;
-	get_text_size(cairo, config->font_description, &text_width, &text_height, NULL, 1,
-			block->markup, "%s", block->full_text);
+	const struct i3bar_block_size *size =
+		get_status_block_size(cairo, output, block);
 
 	int margin = 3;
 	double ws_vertical_padding = config->status_padding;
 
-	int width = text_width;
-
-	if (block->min_width_str) {
-		int w;
-		get_text_size(cairo, config->font_description, &w, NULL, NULL,
-				1, block->markup, "%s", block->min_width_str);
-		block->min_width = w;
-	}
-	if (width < block->min_width) {
-		width = block->min_width;
+	int width = size->full_width;
+	if (width < size->min_width) {
+		width = size->min_width;
 	}
 
-	uint32_t ideal_height = text_height + ws_vertical_padding * 2;
+	uint32_t ideal_height = size->full_height + ws_vertical_padding * 2;
 	uint32_t ideal_surface_height = ideal_height;
 	if (!output->bar->config->height &&
 			output->height < ideal_surface_height) {
@@ -501,24 +801,23 @@ static uint32_t render_status_line_i3bar(struct render_context *ctx, double *x)
 	uint32_t max_height = 0;
 	bool edge = *x == output->width;
 	struct i3bar_block *block;
-	bool use_short_text = false;
 
-	cairo_t *cairo = ctx->cairo;
-	double reserved_width =
-			predict_workspace_buttons_length(cairo, output) +
-			predict_binding_mode_indicator_length(cairo, output) +
-			3; // require a bit of space for margin
+	if (!ctx->draw) {
+		cairo_t *cairo = ctx->cairo;
+		double reserved_width =
+				predict_workspace_buttons_length(cairo, output) +
+				predict_binding_mode_indicator_length(cairo, output) +
+				3; // require a bit of space for margin
 
-	double predicted_full_pos =
-			predict_status_line_pos(cairo, output, *x);
+		double predicted_full_pos =
+				predict_status_line_pos(cairo, output, *x);
 
-	if (predicted_full_pos < reserved_width) {
-		use_short_text = true;
+		ctx->use_short_text = predicted_full_pos < reserved_width;
 	}
 
 	wl_list_for_each(block, &output->bar->status->blocks, link) {
 		uint32_t h = render_status_block(ctx, block, x, edge,
-					use_short_text);
+					ctx->use_short_text);
 		max_height = h > max_height ? h : max_height;
 		edge = false;
 	}
@@ -527,6 +826,11 @@ static uint32_t render_status_line_i3bar(struct render_context *ctx, double *x)
 
 static uint32_t render_status_line(struct render_context *ctx, double *x) {
 	struct status_line *status = ctx->output->bar->status;
+	if (!ctx->draw && status->protocol == PROTOCOL_I3BAR) {
+		// Bursts of updates are only parsed once per frame, and the blocks
+		// must stay the same for the draw pass
+		i3bar_parse_pending(status);
+	}
 	switch (status->protocol) {
 	case PROTOCOL_ERROR:
 		return render_status_line_error(ctx, x);
@@ -566,11 +870,22 @@ static struct box_size render_box(struct render_context *ctx, double x,
 		};
 	}
 
+	ctx->background_color = colors.background;
+	ctx->has_transparency |= (colors.background & 0xFF) != 0xFF;
+	if (!ctx->draw) {
+		uint64_t hash = hash_str(HASH_INIT, label);
+		hash = hash_value(hash, pango_markup);
+		hash = hash_value(hash, colors);
+		add_region(ctx, x, x + width, hash);
+		return (struct box_size) {
+			.width = width,
+			.height = output->height,
+		};
+	}
+
 	uint32_t height = output->height;
 	cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
 	cairo_set_source_u32(cairo, colors.background);
-	ctx->background_color = colors.background;
-	ctx->has_transparency |= (colors.background & 0xFF) != 0xFF;
 	cairo_rectangle(cairo, x, 0, width, height);
 	cairo_fill(cairo);
 
@@ -625,6 +940,10 @@ static enum hotspot_event_handling workspace_hotspot_callback(
 	return HOTSPOT_IGNORE;
 }
 
+static void *copy_workspace_name(void *data) {
+	return strdup(data);
+}
+
 static uint32_t render_workspace_button(struct render_context *ctx,
 		struct swaybar_workspace *ws, double *x) {
 	struct swaybar_output *output = ctx->output;
@@ -644,15 +963,19 @@ static uint32_t render_workspace_button(struct render_context *ctx,
 	struct box_size size = render_box(ctx, *x, box_colors,
 			ws->label, config->pango_markup);
 
-	struct swaybar_hotspot *hotspot = calloc(1, sizeof(struct swaybar_hotspot));
-	hotspot->x = *x;
-	hotspot->y = 0;
-	hotspot->width = size.width;
-	hotspot->height = size.height;
-	hotspot->callback = workspace_hotspot_callback;
-	hotspot->destroy = free;
-	hotspot->data = strdup(ws->name);
-	wl_list_insert(&output->hotspots, &hotspot->link);
+	if (!ctx->draw) {
+		struct swaybar_hotspot *hotspot =
+			calloc(1, sizeof(struct swaybar_hotspot));
+		hotspot->x = *x;
+		hotspot->y = 0;
+		hotspot->width = size.width;
+		hotspot->height = size.height;
+		hotspot->callback = workspace_hotspot_callback;
+		hotspot->destroy = free;
+		hotspot->copy = copy_workspace_name;
+		hotspot->data = strdup(ws->name);
+		wl_list_insert(&output->hotspots, &hotspot->link);
+	}
 
 	*x += size.width;
 	return size.height;
@@ -677,8 +1000,18 @@ static uint32_t render_to_cairo(struct render_context *ctx) {
 	double x = output->width;
 #if HAVE_TRAY
 	if (bar->tray) {
-		uint32_t h = render_tray(cairo, output, &x);
+		double tray_end = x;
+		uint32_t h = render_tray(ctx->draw ? cairo : NULL, output, &x);
 		max_height = h > max_height ? h : max_height;
+
+		uint64_t hash = HASH_INIT;
+		for (int i = 0; i < bar->tray->items->length; ++i) {
+			struct swaybar_sni *sni = bar->tray->items->items[i];
+			hash = hash_str(hash, sni->watcher_id);
+			hash = hash_str(hash, sni->status);
+			hash = hash_value(hash, sni->serial);
+		}
+		add_region(ctx, x, tray_end, hash);
 	}
 #endif
 	if (bar->status) {
@@ -716,6 +1049,172 @@ static const struct wl_callback_listener output_frame_listener = {
 	.done = output_frame_handle_done
 };
 
+static bool has_region(struct swaybar_render_region *regions, size_t len,
+		uint64_t hash) {
+	for (size_t i = 0; i < len; ++i) {
+		if (regions[i].hash == hash) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Collects the regions which are only present in one of the two frames, i.e.
+ * the parts of the bar which changed.
+ */
+static struct swaybar_render_region *diff_regions(
+		struct swaybar_render_region *old, size_t old_len,
+		struct swaybar_render_region *new, size_t new_len, size_t *len) {
+	struct swaybar_render_region *damage =
+		malloc((old_len + new_len + 1) * sizeof(*damage));
+	if (!damage) {
+		return NULL;
+	}
+	*len = 0;
+	for (size_t i = 0; i < old_len; ++i) {
+		if (!has_region(new, new_len, old[i].hash)) {
+			damage[(*len)++] = old[i];
+		}
+	}
+	for (size_t i = 0; i < new_len; ++i) {
+		if (!has_region(old, old_len, new[i].hash)) {
+			damage[(*len)++] = new[i];
+		}
+	}
+	return damage;
+}
+
+static void add_region_paths(cairo_t *cairo, struct swaybar_output *output,
+		struct swaybar_render_region *regions, size_t len) {
+	for (size_t i = 0; i < len; ++i) {
+		cairo_rectangle(cairo, regions[i].x * output->scale, 0,
+				regions[i].width * output->scale,
+				output->height * output->scale);
+	}
+}
+
+static uint64_t get_frame_key(struct swaybar_output *output,
+		uint32_t background_color) {
+	uint64_t hash = hash_value(HASH_INIT, output->width);
+	hash = hash_value(hash, output->height);
+	hash = hash_value(hash, output->scale);
+	hash = hash_value(hash, output->subpixel);
+	hash = hash_value(hash, background_color);
+	hash = hash_value(hash, output->bar->config);
+	return hash;
+}
+
+/**
+ * Hashes everything which can make the bar look different between outputs.
+ * All other state is shared by the outputs, and covered by the content serial.
+ */
+static uint64_t get_render_key(struct swaybar_output *output) {
+	struct swaybar *bar = output->bar;
+	uint64_t hash = hash_value(HASH_INIT, bar->content_serial);
+	hash = hash_value(hash, bar->config);
+	hash = hash_value(hash, output->width);
+	hash = hash_value(hash, output->height);
+	hash = hash_value(hash, output->scale);
+	hash = hash_value(hash, output->subpixel);
+	hash = hash_value(hash, output->focused);
+	if (bar->config->tray_outputs) {
+		// The tray is only shown on some outputs
+		hash = hash_value(hash, output);
+	}
+	struct swaybar_workspace *ws;
+	wl_list_for_each(ws, &output->workspaces, link) {
+		hash = hash_str(hash, ws->name);
+		hash = hash_str(hash, ws->label);
+		hash = hash_value(hash, ws->focused);
+		hash = hash_value(hash, ws->visible);
+		hash = hash_value(hash, ws->urgent);
+	}
+	return hash;
+}
+
+/**
+ * Shows the frame another output already drew for the same render key, by
+ * copying its buffer and hotspots instead of drawing the bar again.
+ */
+static bool share_frame(struct swaybar_output *output,
+		struct swaybar_output *source) {
+	struct swaybar_hotspot *hotspot;
+	wl_list_for_each(hotspot, &source->hotspots, link) {
+		if (hotspot->data && !hotspot->copy) {
+			return false;
+		}
+	}
+
+	struct pool_buffer *src = source->current_buffer;
+	if (!src->buffer) {
+		return false;
+	}
+	output->current_buffer = get_next_buffer(output->bar->shm,
+			&output->pool, src->width, src->height);
+	if (!output->current_buffer) {
+		return false;
+	}
+	struct pool_buffer *dst = output->current_buffer;
+	cairo_surface_flush(src->surface);
+	cairo_surface_flush(dst->surface);
+	memcpy(dst->data, src->data, src->size);
+	cairo_surface_mark_dirty(dst->surface);
+
+	wl_list_for_each_reverse(hotspot, &source->hotspots, link) {
+		struct swaybar_hotspot *copy = calloc(1, sizeof(*copy));
+		if (!copy) {
+			break;
+		}
+		*copy = *hotspot;
+		copy->data = hotspot->data ? hotspot->copy(hotspot->data) : NULL;
+		wl_list_insert(&output->hotspots, &copy->link);
+	}
+
+	wl_surface_set_buffer_scale(output->surface, output->scale);
+	wl_surface_attach(output->surface, dst->buffer, 0, 0);
+	wl_surface_damage_buffer(output->surface, 0, 0, INT32_MAX, INT32_MAX);
+	if (source->opaque) {
+		struct wl_region *region =
+			wl_compositor_create_region(output->bar->compositor);
+		wl_region_add(region, 0, 0, INT32_MAX, INT32_MAX);
+		wl_surface_set_opaque_region(output->surface, region);
+		wl_region_destroy(region);
+	} else {
+		wl_surface_set_opaque_region(output->surface, NULL);
+	}
+
+	struct wl_callback *frame_callback = wl_surface_frame(output->surface);
+	wl_callback_add_listener(frame_callback, &output_frame_listener, output);
+	output->frame_scheduled = true;
+
+	wl_surface_commit(output->surface);
+
+	// The buffer now holds the frame of the source, so continue damage
+	// tracking from there
+	size_t idx = dst - output->pool.buffers;
+	output->buffer_frames[idx] = ++output->frames;
+	struct swaybar_render_region *regions = NULL;
+	if (source->regions_len > 0) {
+		regions = malloc(source->regions_len * sizeof(*regions));
+	}
+	if (regions) {
+		memcpy(regions, source->regions,
+				source->regions_len * sizeof(*regions));
+	}
+	free(output->regions);
+	output->regions = regions;
+	output->regions_len = regions ? source->regions_len : 0;
+	output->frame_key = source->frame_key;
+	output->damage_all = !regions && source->regions_len > 0;
+	free(output->last_damage);
+	output->last_damage = NULL;
+	output->last_damage_len = 0;
+	output->last_damage_all = true;
+	output->opaque = source->opaque;
+	return true;
+}
+
 void render_frame(struct swaybar_output *output) {
 	assert(output->surface != NULL);
 	if (!output->layer_surface) {
@@ -724,6 +1223,19 @@ void render_frame(struct swaybar_output *output) {
 
 	free_hotspots(&output->hotspots);
 
+	uint64_t render_key = get_render_key(output);
+	output->render_key = render_key;
+	output->render_key_valid = false;
+	struct swaybar_output *source;
+	wl_list_for_each(source, &output->bar->outputs, link) {
+		if (source != output && source->render_key_valid &&
+				source->render_key == render_key &&
+				source->current_buffer && share_frame(output, source)) {
+			output->render_key_valid = true;
+			return;
+		}
+	}
+
 	uint32_t background_color;
 	if (output->focused) {
 		background_color = output->bar->config->colors.focused_background;
@@ -738,11 +1250,12 @@ void render_frame(struct swaybar_output *output) {
 		.has_transparency = (background_color & 0xFF) != 0xFF,
 	};
 
-	cairo_surface_t *recorder = cairo_recording_surface_create(
-			CAIRO_CONTENT_COLOR_ALPHA, NULL);
-	cairo_t *cairo = cairo_create(recorder);
+	// The layout pass only measures text, which needs a context with the
+	// scale of the output, but nothing is ever drawn into it
+	cairo_surface_t *scratch =
+		cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1);
+	cairo_t *cairo = cairo_create(scratch);
 	cairo_scale(cairo, output->scale, output->scale);
-	cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
 	ctx.cairo = cairo;
 
 	cairo_font_options_t *fo = cairo_font_options_create();
@@ -758,11 +1271,6 @@ void render_frame(struct swaybar_output *output) {
 		ctx.textaa_sharp = fo;
 	}
 
-
-	cairo_set_operator(cairo, CAIRO_OPERATOR_SOURCE);
-	cairo_set_source_u32(cairo, background_color);
-	cairo_paint(cairo);
-
 	uint32_t height = render_to_cairo(&ctx);
 	int config_height = output->bar->config->height;
 	if (config_height > 0) {
@@ -782,30 +1290,83 @@ void render_frame(struct swaybar_output *output) {
 		// TODO: this could infinite loop if the compositor assigns us a
 		// different height than what we asked for
 		wl_surface_commit(output->surface);
+		output->damage_all = true;
 	} else if (height > 0) {
-		// Replay recording into shm and send it off
+		// Work out which parts of the bar changed since the last frame. Any
+		// pixel outside of the recorded regions only depends on the frame key.
+		uint64_t frame_key = get_frame_key(output, background_color);
+		bool damage_all = output->damage_all || ctx.regions_failed ||
+			frame_key != output->frame_key;
+		struct swaybar_render_region *damage = NULL;
+		size_t damage_len = 0;
+		if (!damage_all) {
+			damage = diff_regions(output->regions, output->regions_len,
+					ctx.regions, ctx.regions_len, &damage_len);
+			if (!damage) {
+				damage_all = true;
+			} else if (damage_len == 0) {
+				// Nothing to draw
+				free(damage);
+				output->render_key_valid = true;
+				goto cleanup;
+			}
+		}
+
+		// Draw straight into shm and send it off
 		output->current_buffer = get_next_buffer(output->bar->shm,
-				output->buffers,
+				&output->pool,
 				output->width * output->scale,
 				output->height * output->scale);
 		if (!output->current_buffer) {
+			free(damage);
 			goto cleanup;
 		}
 		cairo_t *shm = output->current_buffer->cairo;
 
+		// The buffer still holds the frame it was last drawn with, so only
+		// the changes since then need to be repainted
+		size_t idx = output->current_buffer - output->pool.buffers;
+		bool drawn = output->buffer_frames[idx] != 0;
+		uint64_t age = ++output->frames - output->buffer_frames[idx];
+		output->buffer_frames[idx] = output->frames;
+
+		bool repaint_all = damage_all || !drawn || age > 2 ||
+			(age == 2 && output->last_damage_all);
 		cairo_save(shm);
-		cairo_set_operator(shm, CAIRO_OPERATOR_CLEAR);
+		if (!repaint_all) {
+			add_region_paths(shm, output, damage, damage_len);
+			if (age == 2) {
+				add_region_paths(shm, output,
+						output->last_damage, output->last_damage_len);
+			}
+			cairo_clip(shm);
+		}
+		cairo_scale(shm, output->scale, output->scale);
+		cairo_set_antialias(shm, CAIRO_ANTIALIAS_BEST);
+		cairo_set_operator(shm, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_u32(shm, background_color);
 		cairo_paint(shm);
-		cairo_restore(shm);
 
-		cairo_set_source_surface(shm, recorder, 0.0, 0.0);
-		cairo_paint(shm);
+		ctx.cairo = shm;
+		ctx.draw = true;
+		ctx.background_color = background_color;
+		render_to_cairo(&ctx);
+		cairo_restore(shm);
 
 		wl_surface_set_buffer_scale(output->surface, output->scale);
 		wl_surface_attach(output->surface,
 				output->current_buffer->buffer, 0, 0);
-		wl_surface_damage(output->surface, 0, 0,
-				output->width, output->height);
+		if (damage_all) {
+			wl_surface_damage_buffer(output->surface, 0, 0,
+					INT32_MAX, INT32_MAX);
+		} else {
+			for (size_t i = 0; i < damage_len; ++i) {
+				wl_surface_damage_buffer(output->surface,
+						damage[i].x * output->scale, 0,
+						damage[i].width * output->scale,
+						output->height * output->scale);
+			}
+		}
 
 		if (!ctx.has_transparency) {
 			struct wl_region *region =
@@ -822,13 +1383,28 @@ void render_frame(struct swaybar_output *output) {
 		output->frame_scheduled = true;
 
 		wl_surface_commit(output->surface);
+
+		free(output->last_damage);
+		output->last_damage = damage;
+		output->last_damage_len = damage_len;
+		output->last_damage_all = damage_all;
+		output->damage_all = ctx.regions_failed;
+		output->frame_key = frame_key;
+		output->render_key_valid = true;
+		output->opaque = !ctx.has_transparency;
+
+		free(output->regions);
+		output->regions = ctx.regions;
+		output->regions_len = ctx.regions_len;
+		ctx.regions = NULL;
 	}
 
 cleanup:
+	free(ctx.regions);
 	if (ctx.textaa_sharp != ctx.textaa_safe) {
 		cairo_font_options_destroy(ctx.textaa_sharp);
 	}
 	cairo_font_options_destroy(ctx.textaa_safe);
-	cairo_surface_destroy(recorder);
 	cairo_destroy(cairo);
+	cairo_surface_destroy(scratch);
 }
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <sys/ioctl.h>
 #include <json.h>
 #include <stdlib.h>
@@ -116,7 +117,7 @@ bool status_handle_readable(struct status_line *status) {
 		status->text = status->buffer;
 		// intentional fall-through
 	case PROTOCOL_TEXT:
-		while (true) {
+		for (bool first = true; ; first = false) {
 			if (status->buffer[read_bytes - 1] == '\n') {
 				status->buffer[read_bytes - 1] = '\0';
 			}
@@ -130,6 +131,10 @@ bool status_handle_readable(struct status_line *status) {
 				status_error(status, "[error reading from status command]");
 				return true;
 			}
+			if (!first) {
+				// Only the last line of a burst is shown
+				status->updates_dropped++;
+			}
 		}
 	case PROTOCOL_I3BAR:
 		return i3bar_handle_readable(status);
@@ -188,6 +193,8 @@ struct status_line *status_line_init(char *cmd) {
 }
 
 void status_line_free(struct status_line *status) {
+	sway_log(SWAY_DEBUG, "Status updates: %" PRIu64 " dropped, %" PRIu64
+			" coalesced", status->updates_dropped, status->updates_coalesced);
 	status_line_close_fds(status);
 	kill(-status->pid, status->cont_signal);
 	kill(-status->pid, SIGTERM);
@@ -200,6 +207,7 @@ void status_line_free(struct status_line *status) {
 		}
 		json_tokener_free(status->tokener);
 	}
+	free(status->frame);
 	free(status->buffer);
 	free(status);
 }
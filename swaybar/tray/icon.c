@@ -1,9 +1,13 @@
 #include <ctype.h>
 #include <dirent.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <wordexp.h>
@@ -395,39 +399,255 @@ void finish_themes(list_t *themes, list_t *basedirs) {
 	list_free_items_and_destroy(basedirs);
 }
 
-static char *find_icon_in_subdir(char *name, char *basedir, char *theme,
-		char *subdir) {
-	static const char *extensions[] = {
+static const char *extensions[] = {
 #if HAVE_GDK_PIXBUF
-		"svg",
+	"svg",
 #endif
-		"png",
+	"png",
 #if HAVE_GDK_PIXBUF
-		"xpm" // deprecated
+	"xpm" // deprecated
 #endif
-	};
+};
 
-	for (size_t i = 0; i < sizeof(extensions) / sizeof(*extensions); ++i) {
-		char *path = format_str("%s/%s/%s/%s.%s",
-			basedir, theme, subdir, name, extensions[i]);
-		if (access(path, R_OK) == 0) {
-			return path;
+/*
+ * The icon index caches the contents of every directory an icon has been
+ * looked up in, so that repeated lookups don't have to probe the filesystem
+ * for every combination of base directory, theme, subdirectory and extension.
+ * Directories and the icons in them share one hash table. The index is
+ * dropped whenever inotify reports a change in one of the directories.
+ */
+struct icon_index_entry {
+	struct icon_index_entry *next; // in the same bucket
+	uint32_t hash;
+	const struct icon_index_entry *dir; // NULL for directories
+	bool exists; // for directories, whether they could be read
+	uint8_t extensions; // for icons, bit i is set if name.extensions[i] exists
+	char name[]; // full path for directories
+};
+
+static uint32_t icon_index_hash(const struct icon_index_entry *dir,
+		const char *name, size_t len) {
+	uint32_t hash = 2166136261;
+	for (size_t i = 0; i < sizeof(dir); ++i) {
+		hash = (hash ^ (uint8_t)((uintptr_t)dir >> (i * 8))) * 16777619;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ (uint8_t)name[i]) * 16777619;
+	}
+	return hash;
+}
+
+static struct icon_index_entry *icon_index_find(struct icon_index *index,
+		const struct icon_index_entry *dir, const char *name, size_t len) {
+	if (!index->buckets) {
+		return NULL;
+	}
+	uint32_t hash = icon_index_hash(dir, name, len);
+	struct icon_index_entry *entry =
+		index->buckets[hash & (index->nbuckets - 1)];
+	for (; entry; entry = entry->next) {
+		if (entry->hash == hash && entry->dir == dir &&
+				strncmp(entry->name, name, len) == 0 &&
+				entry->name[len] == '\0') {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static bool icon_index_grow(struct icon_index *index) {
+	size_t nbuckets = index->nbuckets ? index->nbuckets * 2 : 256;
+	struct icon_index_entry **buckets = calloc(nbuckets, sizeof(*buckets));
+	if (!buckets) {
+		return false;
+	}
+	for (size_t i = 0; i < index->nbuckets; ++i) {
+		struct icon_index_entry *entry = index->buckets[i], *next;
+		for (; entry; entry = next) {
+			next = entry->next;
+			size_t bucket = entry->hash & (nbuckets - 1);
+			entry->next = buckets[bucket];
+			buckets[bucket] = entry;
+		}
+	}
+	free(index->buckets);
+	index->buckets = buckets;
+	index->nbuckets = nbuckets;
+	return true;
+}
+
+static struct icon_index_entry *icon_index_add(struct icon_index *index,
+		const struct icon_index_entry *dir, const char *name, size_t len) {
+	if (index->len >= index->nbuckets && !icon_index_grow(index)) {
+		return NULL;
+	}
+	struct icon_index_entry *entry = calloc(1, sizeof(*entry) + len + 1);
+	if (!entry) {
+		return NULL;
+	}
+	entry->hash = icon_index_hash(dir, name, len);
+	entry->dir = dir;
+	memcpy(entry->name, name, len);
+	size_t bucket = entry->hash & (index->nbuckets - 1);
+	entry->next = index->buckets[bucket];
+	index->buckets[bucket] = entry;
+	index->len++;
+	return entry;
+}
+
+static void icon_index_clear(struct icon_index *index) {
+	for (size_t i = 0; i < index->nbuckets; ++i) {
+		struct icon_index_entry *entry = index->buckets[i], *next;
+		for (; entry; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+	}
+	free(index->buckets);
+	index->buckets = NULL;
+	index->nbuckets = index->len = 0;
+}
+
+static void icon_index_watch(struct icon_index *index, const char *path) {
+	if (index->fd == -1) {
+		return;
+	}
+	// Watching the same directory again reuses the existing watch
+	inotify_add_watch(index->fd, path, IN_CREATE | IN_DELETE |
+			IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF |
+			IN_ONLYDIR);
+}
+
+static void icon_index_read_dir(struct icon_index *index,
+		struct icon_index_entry *dir) {
+	DIR *d = opendir(dir->name);
+	if (!d) {
+		// Notice the directory being created
+		char *parent = strdup(dir->name);
+		char *slash = parent ? strrchr(parent, '/') : NULL;
+		if (slash) {
+			*slash = '\0';
+			icon_index_watch(index, parent);
+		}
+		free(parent);
+		return;
+	}
+	dir->exists = true;
+	icon_index_watch(index, dir->name);
+
+	struct dirent *dirent;
+	while ((dirent = readdir(d))) {
+		char *ext = strrchr(dirent->d_name, '.');
+		if (!ext || ext == dirent->d_name) {
+			continue;
 		}
-		free(path);
+		for (size_t i = 0; i < sizeof(extensions) / sizeof(*extensions); ++i) {
+			if (strcmp(ext + 1, extensions[i]) != 0) {
+				continue;
+			}
+			size_t len = ext - dirent->d_name;
+			struct icon_index_entry *icon =
+				icon_index_find(index, dir, dirent->d_name, len);
+			if (!icon) {
+				icon = icon_index_add(index, dir, dirent->d_name, len);
+			}
+			if (icon) {
+				icon->extensions |= 1 << i;
+			}
+			break;
+		}
+	}
+	closedir(d);
+}
+
+static const struct icon_index_entry *icon_index_get_dir(
+		struct icon_index *index, const char *path) {
+	size_t len = strlen(path);
+	struct icon_index_entry *dir = icon_index_find(index, NULL, path, len);
+	if (!dir) {
+		dir = icon_index_add(index, NULL, path, len);
+		if (!dir) {
+			return NULL;
+		}
+		icon_index_read_dir(index, dir);
+	}
+	return dir;
+}
+
+struct icon_index *create_icon_index(void) {
+	struct icon_index *index = calloc(1, sizeof(struct icon_index));
+	if (!index) {
+		return NULL;
+	}
+	index->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (index->fd == -1) {
+		sway_log_errno(SWAY_INFO, "Unable to watch icon directories");
+	}
+	return index;
+}
+
+void destroy_icon_index(struct icon_index *index) {
+	if (!index) {
+		return;
+	}
+	icon_index_clear(index);
+	if (index->fd != -1) {
+		close(index->fd);
+	}
+	free(index);
+}
+
+bool icon_index_handle_readable(struct icon_index *index) {
+	_Alignas(struct inotify_event) char buf[4096];
+	bool changed = false;
+	while (read(index->fd, buf, sizeof(buf)) > 0) {
+		changed = true;
 	}
+	if (changed && index->len > 0) {
+		sway_log(SWAY_DEBUG, "Icon directories changed, dropping icon index");
+		icon_index_clear(index);
+	}
+	return changed;
+}
 
+static char *find_icon_in_subdir(struct icon_index *index, char *name,
+		char *basedir, char *theme, char *subdir) {
+	char path[PATH_MAX];
+	int len = snprintf(path, sizeof(path), "%s/%s/%s", basedir, theme, subdir);
+	if (len < 0 || (size_t)len >= sizeof(path)) {
+		return NULL;
+	}
+	const struct icon_index_entry *dir = icon_index_get_dir(index, path);
+	if (!dir || !dir->exists) {
+		return NULL;
+	}
+	const struct icon_index_entry *icon =
+		icon_index_find(index, dir, name, strlen(name));
+	if (!icon) {
+		return NULL;
+	}
+	for (size_t i = 0; i < sizeof(extensions) / sizeof(*extensions); ++i) {
+		if (icon->extensions & (1 << i)) {
+			return format_str("%s/%s.%s", path, name, extensions[i]);
+		}
+	}
 	return NULL;
 }
 
-static bool theme_exists_in_basedir(char *theme, char *basedir) {
-	char *path = format_str("%s/%s", basedir, theme);
-	bool ret = dir_exists(path);
-	free(path);
-	return ret;
+static bool theme_exists_in_basedir(struct icon_index *index, char *theme,
+		char *basedir) {
+	char path[PATH_MAX];
+	int len = snprintf(path, sizeof(path), "%s/%s", basedir, theme);
+	if (len < 0 || (size_t)len >= sizeof(path)) {
+		return false;
+	}
+	const struct icon_index_entry *dir = icon_index_get_dir(index, path);
+	return dir && dir->exists;
 }
 
-static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
-		int size, char *theme_name, int *min_size, int *max_size) {
+static char *find_icon_with_theme(struct icon_index *index, list_t *basedirs,
+		list_t *themes, char *name, int size, char *theme_name,
+		int *min_size, int *max_size) {
 	struct icon_theme *theme = NULL;
 	for (int i = 0; i < themes->length; ++i) {
 		theme = themes->items[i];
@@ -440,14 +660,14 @@ static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
 
 	char *icon = NULL;
 	for (int i = 0; i < basedirs->length; ++i) {
-		if (!theme_exists_in_basedir(theme->dir, basedirs->items[i])) {
+		if (!theme_exists_in_basedir(index, theme->dir, basedirs->items[i])) {
 			continue;
 		}
 		// search backwards to hopefully hit scalable/larger icons first
 		for (int j = theme->subdirs->length - 1; j >= 0; --j) {
 			struct icon_theme_subdir *subdir = theme->subdirs->items[j];
 			if (size >= subdir->min_size && size <= subdir->max_size) {
-				if ((icon = find_icon_in_subdir(name, basedirs->items[i],
+				if ((icon = find_icon_in_subdir(index, name, basedirs->items[i],
 								theme->dir, subdir->name))) {
 					*min_size = subdir->min_size;
 					*max_size = subdir->max_size;
@@ -460,7 +680,7 @@ static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
 	// inexact match
 	unsigned smallest_error = -1; // UINT_MAX
 	for (int i = 0; i < basedirs->length; ++i) {
-		if (!theme_exists_in_basedir(theme->dir, basedirs->items[i])) {
+		if (!theme_exists_in_basedir(index, theme->dir, basedirs->items[i])) {
 			continue;
 		}
 		for (int j = theme->subdirs->length - 1; j >= 0; --j) {
@@ -468,7 +688,7 @@ static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
 			unsigned error = (size > subdir->max_size ? size - subdir->max_size : 0)
 				+ (size < subdir->min_size ? subdir->min_size - size : 0);
 			if (error < smallest_error) {
-				char *test_icon = find_icon_in_subdir(name, basedirs->items[i],
+				char *test_icon = find_icon_in_subdir(index, name, basedirs->items[i],
 						theme->dir, subdir->name);
 				if (test_icon) {
 					icon = test_icon;
@@ -482,7 +702,7 @@ static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
 
 	if (!icon && theme->inherits) {
 		for (int i = 0; i < theme->inherits->length; ++i) {
-			icon = find_icon_with_theme(basedirs, themes, name, size,
+			icon = find_icon_with_theme(index, basedirs, themes, name, size,
 					theme->inherits->items[i], min_size, max_size);
 			if (icon) {
 				break;
@@ -493,10 +713,10 @@ static char *find_icon_with_theme(list_t *basedirs, list_t *themes, char *name,
 	return icon;
 }
 
-static char *find_fallback_icon(list_t *basedirs, char *name, int *min_size,
-		int *max_size) {
+static char *find_fallback_icon(struct icon_index *index, list_t *basedirs,
+		char *name, int *min_size, int *max_size) {
 	for (int i = 0; i < basedirs->length; ++i) {
-		char *icon = find_icon_in_subdir(name, basedirs->items[i], "", "");
+		char *icon = find_icon_in_subdir(index, name, basedirs->items[i], "", "");
 		if (icon) {
 			*min_size = 1;
 			*max_size = 512;
@@ -506,20 +726,20 @@ static char *find_fallback_icon(list_t *basedirs, char *name, int *min_size,
 	return NULL;
 }
 
-char *find_icon(list_t *themes, list_t *basedirs, char *name, int size,
-		char *theme, int *min_size, int *max_size) {
+char *find_icon(struct icon_index *index, list_t *themes, list_t *basedirs,
+		char *name, int size, char *theme, int *min_size, int *max_size) {
 	// TODO https://specifications.freedesktop.org/icon-theme-spec/icon-theme-spec-latest.html#implementation_notes
 	char *icon = NULL;
 	if (theme) {
-		icon = find_icon_with_theme(basedirs, themes, name, size, theme,
-				min_size, max_size);
+		icon = find_icon_with_theme(index, basedirs, themes, name, size,
+				theme, min_size, max_size);
 	}
 	if (!icon && !(theme && strcmp(theme, "Hicolor") == 0)) {
-		icon = find_icon_with_theme(basedirs, themes, name, size, "Hicolor",
-				min_size, max_size);
+		icon = find_icon_with_theme(index, basedirs, themes, name, size,
+				"Hicolor", min_size, max_size);
 	}
 	if (!icon) {
-		icon = find_fallback_icon(basedirs, name, min_size, max_size);
+		icon = find_fallback_icon(index, basedirs, name, min_size, max_size);
 	}
 	return icon;
 }
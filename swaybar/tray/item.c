@@ -1,4 +1,3 @@
-#include <arpa/inet.h>
 #include <cairo.h>
 #include <limits.h>
 #include <stdbool.h>
@@ -6,7 +5,6 @@
 #include <string.h>
 #include "swaybar/bar.h"
 #include "swaybar/config.h"
-#include "swaybar/image.h"
 #include "swaybar/input.h"
 #include "swaybar/tray/host.h"
 #include "swaybar/tray/icon.h"
@@ -27,12 +25,34 @@ static bool sni_ready(struct swaybar_sni *sni) {
 }
 
 static void set_sni_dirty(struct swaybar_sni *sni) {
+	++sni->serial;
 	if (sni_ready(sni)) {
 		sni->target_size = sni->min_size = sni->max_size = 0; // invalidate previous icon
 		set_bar_dirty(sni->tray->bar);
 	}
 }
 
+/**
+ * Converts ARGB32 pixels from network byte order to host byte order and
+ * returns a hash of them. Reading each pixel byte by byte doesn't require the
+ * source to be aligned, and is recognized by compilers as a byte swap which
+ * they vectorize.
+ */
+static uint64_t convert_pixmap(uint32_t *restrict dst,
+		const uint8_t *restrict src, size_t npixels) {
+	for (size_t i = 0; i < npixels; ++i) {
+		dst[i] = (uint32_t)src[4 * i] << 24 | (uint32_t)src[4 * i + 1] << 16 |
+			(uint32_t)src[4 * i + 2] << 8 | (uint32_t)src[4 * i + 3];
+	}
+
+	// FNV-1a, a word at a time
+	uint64_t hash = UINT64_C(14695981039346656037);
+	for (size_t i = 0; i < npixels; ++i) {
+		hash = (hash ^ dst[i]) * UINT64_C(1099511628211);
+	}
+	return hash;
+}
+
 static int read_pixmap(sd_bus_message *msg, struct swaybar_sni *sni,
 		const char *prop, list_t **dest) {
 	int ret = sd_bus_message_enter_container(msg, 'a', "(iiay)");
@@ -73,16 +93,19 @@ static int read_pixmap(sd_bus_message *msg, struct swaybar_sni *sni,
 			goto error;
 		}
 
-		if (height > 0 && width == height) {
+		if (height > 0 && width == height &&
+				npixels / 4 / width >= (size_t)height) {
 			sway_log(SWAY_DEBUG, "%s %s: found icon w:%d h:%d", sni->watcher_id, prop, width, height);
 			struct swaybar_pixmap *pixmap =
 				malloc(sizeof(struct swaybar_pixmap) + npixels);
-			pixmap->size = height;
-
-			// convert from network byte order to host byte order
-			for (int i = 0; i < height * width; ++i) {
-				((uint32_t *)pixmap->pixels)[i] = ntohl(((uint32_t *)pixels)[i]);
+			if (!pixmap) {
+				ret = -12; // -ENOMEM
+				goto error;
 			}
+			pixmap->size = height;
+			pixmap->hash = convert_pixmap((uint32_t *)pixmap->pixels, pixels,
+					(size_t)width * height);
+			pixmap->hash ^= height;
 
 			list_add(pixmaps, pixmap);
 		} else {
@@ -425,13 +448,13 @@ static void reload_sni(struct swaybar_sni *sni, char *icon_theme,
 		if (sni->icon_theme_path) {
 			list_add(icon_search_paths, sni->icon_theme_path);
 		}
-		char *icon_path = find_icon(sni->tray->themes, icon_search_paths,
-				icon_name, target_size, icon_theme,
+		char *icon_path = find_icon(sni->tray->icons, sni->tray->themes,
+				icon_search_paths, icon_name, target_size, icon_theme,
 				&sni->min_size, &sni->max_size);
 		list_free(icon_search_paths);
 		if (icon_path) {
 			cairo_surface_destroy(sni->icon);
-			sni->icon = load_image(icon_path);
+			sni->icon = tray_load_file_icon(sni->tray, icon_path);
 			free(icon_path);
 			return;
 		}
@@ -451,18 +474,20 @@ static void reload_sni(struct swaybar_sni *sni, char *icon_theme,
 			}
 		}
 		cairo_surface_destroy(sni->icon);
-		sni->icon = cairo_image_surface_create_for_data(pixmap->pixels,
-				CAIRO_FORMAT_ARGB32, pixmap->size, pixmap->size,
-				cairo_format_stride_for_width(CAIRO_FORMAT_ARGB32, pixmap->size));
+		sni->icon = tray_load_pixmap_icon(sni->tray, pixmap);
 	}
 }
 
+static void *copy_watcher_id(void *data) {
+	return strdup(data);
+}
+
 uint32_t render_sni(cairo_t *cairo, struct swaybar_output *output, double *x,
 		struct swaybar_sni *sni) {
 	uint32_t height = output->height * output->scale;
 	int padding = output->bar->config->tray_padding;
 	int target_size = height - 2*padding;
-	if (target_size != sni->target_size && sni_ready(sni)) {
+	if (!cairo && target_size != sni->target_size && sni_ready(sni)) {
 		// check if another icon should be loaded
 		if (target_size < sni->min_size || target_size > sni->max_size) {
 			reload_sni(sni, output->bar->config->icon_theme, target_size);
@@ -477,14 +502,39 @@ uint32_t render_sni(cairo_t *cairo, struct swaybar_output *output, double *x,
 	}
 
 	int icon_size;
-	cairo_surface_t *icon;
 	if (sni->icon) {
 		int actual_size = cairo_image_surface_get_height(sni->icon);
 		icon_size = actual_size < target_size ?
 			actual_size*(target_size/actual_size) : target_size;
-		icon = cairo_image_surface_scale(sni->icon, icon_size, icon_size);
-	} else { // draw a :(
+	} else {
 		icon_size = target_size*0.8;
+	}
+
+	double descaled_padding = (double)padding / output->scale;
+	double descaled_icon_size = (double)icon_size / output->scale;
+
+	int size = descaled_icon_size + 2 * descaled_padding;
+	*x -= size;
+
+	if (!cairo) {
+		struct swaybar_hotspot *hotspot =
+			calloc(1, sizeof(struct swaybar_hotspot));
+		hotspot->x = *x;
+		hotspot->y = 0;
+		hotspot->width = size;
+		hotspot->height = output->height;
+		hotspot->callback = icon_hotspot_callback;
+		hotspot->destroy = free;
+		hotspot->copy = copy_watcher_id;
+		hotspot->data = strdup(sni->watcher_id);
+		wl_list_insert(&output->hotspots, &hotspot->link);
+		return output->height;
+	}
+
+	cairo_surface_t *icon;
+	if (sni->icon) {
+		icon = tray_scale_icon(sni->tray, sni->icon, icon_size);
+	} else { // draw a :(
 		icon = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, icon_size, icon_size);
 		cairo_t *cairo_icon = cairo_create(icon);
 		cairo_set_source_u32(cairo_icon, 0xFF0000FF);
@@ -503,11 +553,6 @@ uint32_t render_sni(cairo_t *cairo, struct swaybar_output *output, double *x,
 		cairo_destroy(cairo_icon);
 	}
 
-	double descaled_padding = (double)padding / output->scale;
-	double descaled_icon_size = (double)icon_size / output->scale;
-
-	int size = descaled_icon_size + 2 * descaled_padding;
-	*x -= size;
 	int icon_y = floor((output->height - size) / 2.0);
 
 	cairo_operator_t op = cairo_get_operator(cairo);
@@ -528,15 +573,5 @@ uint32_t render_sni(cairo_t *cairo, struct swaybar_output *output, double *x,
 	cairo_pattern_destroy(icon_pattern);
 	cairo_surface_destroy(icon);
 
-	struct swaybar_hotspot *hotspot = calloc(1, sizeof(struct swaybar_hotspot));
-	hotspot->x = *x;
-	hotspot->y = 0;
-	hotspot->width = size;
-	hotspot->height = output->height;
-	hotspot->callback = icon_hotspot_callback;
-	hotspot->destroy = free;
-	hotspot->data = strdup(sni->watcher_id);
-	wl_list_insert(&output->hotspots, &hotspot->link);
-
 	return output->height;
 }
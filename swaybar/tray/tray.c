@@ -1,15 +1,18 @@
 #include <cairo.h>
 #include <poll.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "swaybar/config.h"
 #include "swaybar/bar.h"
+#include "swaybar/image.h"
 #include "swaybar/tray/icon.h"
 #include "swaybar/tray/host.h"
 #include "swaybar/tray/item.h"
 #include "swaybar/tray/tray.h"
 #include "swaybar/tray/watcher.h"
+#include "cairo_util.h"
 #include "list.h"
 #include "log.h"
 
@@ -64,15 +67,167 @@ struct swaybar_tray *create_tray(struct swaybar *bar) {
 	}
 
 	tray->items = create_list();
+	wl_list_init(&tray->icon_cache);
 
 	init_host(&tray->host_xdg, "freedesktop", tray);
 	init_host(&tray->host_kde, "kde", tray);
 
 	init_themes(&tray->themes, &tray->basedirs);
+	tray->icons = create_icon_index();
+	if (!tray->icons) {
+		sway_log(SWAY_ERROR, "Unable to allocate icon index");
+		destroy_tray(tray);
+		return NULL;
+	}
 
 	return tray;
 }
 
+// Unused icons are kept for this many calls to render_tray
+#define ICON_CACHE_GENERATIONS 64
+
+static void destroy_tray_icon(struct swaybar_tray_icon *icon) {
+	wl_list_remove(&icon->link);
+	cairo_surface_destroy(icon->surface);
+	cairo_surface_destroy(icon->source);
+	free(icon->path);
+	free(icon);
+}
+
+static void expire_tray_icons(struct swaybar_tray *tray, bool all) {
+	struct swaybar_tray_icon *icon, *tmp;
+	wl_list_for_each_safe(icon, tmp, &tray->icon_cache, link) {
+		// Icons still referenced by an item, or by a scaled icon, are cheap to
+		// keep. A source icon expires once its scaled icons have.
+		bool unused = cairo_surface_get_reference_count(icon->surface) == 1;
+		if (all || (unused && icon->last_used + ICON_CACHE_GENERATIONS <
+				tray->icon_cache_generation)) {
+			destroy_tray_icon(icon);
+		}
+	}
+}
+
+static cairo_surface_t *tray_use_icon(struct swaybar_tray *tray,
+		struct swaybar_tray_icon *icon) {
+	icon->last_used = tray->icon_cache_generation;
+	return cairo_surface_reference(icon->surface);
+}
+
+/**
+ * Adds the surface to the icon cache, taking ownership of it and of the
+ * icon. Returns a new reference to the surface, or NULL if it is NULL.
+ */
+static cairo_surface_t *tray_add_icon(struct swaybar_tray *tray,
+		struct swaybar_tray_icon *icon, cairo_surface_t *surface) {
+	if (!surface) {
+		cairo_surface_destroy(icon->source);
+		free(icon->path);
+		free(icon);
+		return NULL;
+	}
+	icon->surface = surface;
+	wl_list_insert(&tray->icon_cache, &icon->link);
+	return tray_use_icon(tray, icon);
+}
+
+cairo_surface_t *tray_load_file_icon(struct swaybar_tray *tray,
+		const char *path) {
+	// Applications may rewrite their icon file in place, which the icon index
+	// doesn't notice, so the file is part of the key
+	struct stat st;
+	if (stat(path, &st) != 0) {
+		return load_image(path);
+	}
+	struct swaybar_tray_icon *icon;
+	wl_list_for_each(icon, &tray->icon_cache, link) {
+		if (icon->path && strcmp(icon->path, path) == 0 &&
+				icon->mtime.tv_sec == st.st_mtim.tv_sec &&
+				icon->mtime.tv_nsec == st.st_mtim.tv_nsec &&
+				icon->file_size == st.st_size) {
+			return tray_use_icon(tray, icon);
+		}
+	}
+
+	cairo_surface_t *surface = load_image(path);
+	icon = calloc(1, sizeof(*icon));
+	if (!icon || !(icon->path = strdup(path))) {
+		// Still usable, just not cached
+		free(icon);
+		return surface;
+	}
+	icon->mtime = st.st_mtim;
+	icon->file_size = st.st_size;
+	return tray_add_icon(tray, icon, surface);
+}
+
+static bool pixmap_icon_equal(cairo_surface_t *surface,
+		struct swaybar_pixmap *pixmap) {
+	if (cairo_image_surface_get_height(surface) != pixmap->size) {
+		return false;
+	}
+	unsigned char *data = cairo_image_surface_get_data(surface);
+	int stride = cairo_image_surface_get_stride(surface);
+	size_t row = (size_t)pixmap->size * 4;
+	for (int y = 0; data && y < pixmap->size; ++y) {
+		if (memcmp(data + y * stride, pixmap->pixels + y * row, row) != 0) {
+			return false;
+		}
+	}
+	return data != NULL;
+}
+
+cairo_surface_t *tray_load_pixmap_icon(struct swaybar_tray *tray,
+		struct swaybar_pixmap *pixmap) {
+	struct swaybar_tray_icon *icon;
+	wl_list_for_each(icon, &tray->icon_cache, link) {
+		if (!icon->path && !icon->source &&
+				icon->pixmap_hash == pixmap->hash &&
+				pixmap_icon_equal(icon->surface, pixmap)) {
+			return tray_use_icon(tray, icon);
+		}
+	}
+
+	// Copied, since the cache outlives the pixmaps of the item
+	cairo_surface_t *surface = cairo_image_surface_create(
+			CAIRO_FORMAT_ARGB32, pixmap->size, pixmap->size);
+	cairo_surface_flush(surface);
+	unsigned char *data = cairo_image_surface_get_data(surface);
+	int stride = cairo_image_surface_get_stride(surface);
+	size_t row = (size_t)pixmap->size * 4;
+	for (int y = 0; data && y < pixmap->size; ++y) {
+		memcpy(data + y * stride, pixmap->pixels + y * row, row);
+	}
+	cairo_surface_mark_dirty(surface);
+
+	icon = calloc(1, sizeof(*icon));
+	if (!icon) {
+		return surface;
+	}
+	icon->pixmap_hash = pixmap->hash;
+	return tray_add_icon(tray, icon, surface);
+}
+
+cairo_surface_t *tray_scale_icon(struct swaybar_tray *tray,
+		cairo_surface_t *source, int size) {
+	// The source is referenced by its scaled icons, so it can't be replaced
+	// by another icon at the same address while they are cached
+	struct swaybar_tray_icon *icon;
+	wl_list_for_each(icon, &tray->icon_cache, link) {
+		if (icon->source == source && icon->size == size) {
+			return tray_use_icon(tray, icon);
+		}
+	}
+
+	cairo_surface_t *surface = cairo_image_surface_scale(source, size, size);
+	icon = calloc(1, sizeof(*icon));
+	if (!icon) {
+		return surface;
+	}
+	icon->source = cairo_surface_reference(source);
+	icon->size = size;
+	return tray_add_icon(tray, icon, surface);
+}
+
 void destroy_tray(struct swaybar_tray *tray) {
 	if (!tray) {
 		return;
@@ -83,10 +238,12 @@ void destroy_tray(struct swaybar_tray *tray) {
 		destroy_sni(tray->items->items[i]);
 	}
 	list_free(tray->items);
+	expire_tray_icons(tray, true);
 	destroy_watcher(tray->watcher_xdg);
 	destroy_watcher(tray->watcher_kde);
 	sd_bus_flush_close_unref(tray->bus);
 	finish_themes(tray->themes, tray->basedirs);
+	destroy_icon_index(tray->icons);
 	free(tray);
 }
 
@@ -108,6 +265,14 @@ void tray_in(int fd, short mask, void *data) {
 	}
 }
 
+void tray_icons_in(int fd, short mask, void *data) {
+	struct swaybar *bar = data;
+	if (icon_index_handle_readable(bar->tray->icons)) {
+		// Icon files might have been replaced as well
+		expire_tray_icons(bar->tray, true);
+	}
+}
+
 static int cmp_output(const void *item, const void *cmp_to) {
 	const struct swaybar_output *output = cmp_to;
 	if (output->identifier && strcmp(item, output->identifier) == 0) {
@@ -130,12 +295,18 @@ uint32_t render_tray(cairo_t *cairo, struct swaybar_output *output, double *x) {
 
 	uint32_t max_height = 0;
 	struct swaybar_tray *tray = output->bar->tray;
+	if (cairo) {
+		tray->icon_cache_generation++;
+	}
 	for (int i = 0; i < tray->items->length; ++i) {
 		uint32_t h = render_sni(cairo, output, x, tray->items->items[i]);
 		if (h > max_height) {
 			max_height = h;
 		}
 	}
+	if (cairo) {
+		expire_tray_icons(tray, false);
+	}
 
 	return max_height;
 }
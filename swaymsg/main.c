@@ -550,6 +550,14 @@ int main(int argc, char **argv) {
 		type = IPC_GET_BINDING_STATE;
 	} else if (strcasecmp(cmdtype, "get_config") == 0) {
 		type = IPC_GET_CONFIG;
+	} else if (strcasecmp(cmdtype, "get_stats") == 0) {
+		type = IPC_GET_STATS;
+	} else if (strcasecmp(cmdtype, "get_output_stats") == 0) {
+		type = IPC_GET_OUTPUT_STATS;
+	} else if (strcasecmp(cmdtype, "get_transaction_stats") == 0) {
+		type = IPC_GET_TRANSACTION_STATS;
+	} else if (strcasecmp(cmdtype, "get_tree_snapshot") == 0) {
+		type = IPC_GET_TREE_SNAPSHOT;
 	} else if (strcasecmp(cmdtype, "send_tick") == 0) {
 		type = IPC_SEND_TICK;
 	} else if (strcasecmp(cmdtype, "subscribe") == 0) {
@@ -456,6 +456,7 @@ void swaynag_setup(struct swaynag *swaynag) {
 	}
 
 	swaynag->scale = 1;
+	buffer_pool_init(&swaynag->pool, SWAYNAG_BUFFERS);
 
 	struct wl_registry *registry = wl_display_get_registry(swaynag->display);
 	wl_registry_add_listener(registry, &registry_listener, swaynag);
@@ -542,8 +543,7 @@ void swaynag_destroy(struct swaynag *swaynag) {
 		swaynag_seat_destroy(seat);
 	}
 
-	destroy_buffer(&swaynag->buffers[0]);
-	destroy_buffer(&swaynag->buffers[1]);
+	buffer_pool_finish(&swaynag->pool);
 
 	if (swaynag->outputs.prev || swaynag->outputs.next) {
 		struct swaynag_output *output, *temp;